@@ -0,0 +1,75 @@
+#!/bin/sh -
+# ======================================================================
+#  compare per-event digest files (Run/DigestFile)
+# ======================================================================
+export LANG=C
+
+# ======================================================================
+# help message
+# ======================================================================
+show_help() {
+cat <<EOF
+
+\`digest_diff.sh' finds the first divergent event of two digest files.
+
+Usage: digest_diff.sh [OPTION] REFERENCE DIGEST
+
+Options:
+  -h, --help                display this help and exit
+EOF
+}
+
+# ======================================================================
+# main
+# ======================================================================
+# parsing options
+while test $# -gt 0
+do
+  case $1 in
+    --help|-h) show_help;  exit 0 ;;
+    *) break ;;
+  esac
+  shift
+done
+
+if [ $# -ne 2 ]; then
+  show_help
+  exit -1
+fi
+
+for f in "$1" "$2"; do
+  if [ ! -f "$f" ]; then
+    echo "[ERROR] no digest file, $f"
+    exit -1
+  fi
+done
+
+# records are in event order: event steps edep(eV) tracks digest
+awk '
+  FNR == NR { if ( $1 !~ /^#/ ) ref[$1] = $0; next }
+  $1 ~ /^#/ { next }
+  {
+    nevents++
+    if ( ! ($1 in ref) ) {
+      printf("event %d : missing in reference\n", $1)
+      diverged = 1; exit 1
+    }
+    if ( ref[$1] != $0 ) {
+      split(ref[$1], r)
+      printf("first divergent event : %d\n", $1)
+      printf("  reference : steps=%s edep=%s eV tracks=%s digest=%s\n",
+             r[2], r[3], r[4], r[5])
+      printf("  digest    : steps=%s edep=%s eV tracks=%s digest=%s\n",
+             $2, $3, $4, $5)
+      diverged = 1; exit 1
+    }
+    delete ref[$1]
+  }
+  END {
+    if ( diverged ) exit 1
+    for ( id in ref ) {
+      printf("event %d : missing in digest\n", id); exit 1
+    }
+    printf("identical : %d events\n", nevents)
+  }
+' "$1" "$2"
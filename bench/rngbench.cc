@@ -0,0 +1,175 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <getopt.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CLHEP/Random/RandomEngine.h"
+#include "common/randomengine.h"
+
+namespace {
+// --------------------------------------------------------------------------
+void show_help()
+{
+  const char* message =
+R"(
+usage:
+rngbench [options]
+
+   -h, --help              show this message.
+   -e, --engine=name       benchmark only this engine [all]
+   -n, --nthreads=N        set number of threads [1]
+   -N, --numbers=N         set random numbers per thread [100000000]
+   -b, --block=N           use flatArray() with blocks of N, 0 = flat() [0]
+)";
+
+   std::cout << message << std::endl;
+}
+
+// --------------------------------------------------------------------------
+struct Result {
+  double seconds;
+  double sum;
+};
+
+void run_engine(const std::string& name, int tid, long nnumbers, int nblock,
+                Result& result)
+{
+  auto engine = RandomEngine::Create(name);
+  engine-> setSeed(123456789L + tid, RandomEngine::GetLuxury(name));
+
+  double sum = 0.;
+  std::vector<double> block(nblock);
+
+  auto t0 = std::chrono::steady_clock::now();
+  if ( nblock > 0 ) {
+    for ( long i = 0; i < nnumbers; i += nblock ) {
+      int n = std::min<long>(nblock, nnumbers - i);
+      engine-> flatArray(n, block.data());
+      sum += block[0];
+    }
+  } else {
+    for ( long i = 0; i < nnumbers; i++ ) sum += engine-> flat();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  result.seconds = std::chrono::duration<double>(t1 - t0).count();
+  result.sum = sum;
+
+  delete engine;
+}
+
+} // end of namespace
+
+// --------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  std::string engine_name = "";
+  int nthreads = 1;
+  long nnumbers = 100000000L;
+  int nblock = 0;
+
+  struct option long_options[] = {
+    {"help",      no_argument,        0 ,  'h'},
+    {"engine",    required_argument,  0 ,  'e'},
+    {"nthreads",  required_argument,  0 ,  'n'},
+    {"numbers",   required_argument,  0 ,  'N'},
+    {"block",     required_argument,  0 ,  'b'},
+    {0,           0,                  0,    0}
+  };
+
+  while (1) {
+    int option_index = -1;
+
+    int c = getopt_long(argc, argv, "he:n:N:b:", long_options, &option_index);
+
+    if (c == -1) break;
+
+    switch (c) {
+    case 'h' :
+      show_help();
+      std::exit(EXIT_SUCCESS);
+    case 'e' :
+      engine_name = optarg;
+      break;
+    case 'n' :
+      nthreads = std::stoi(optarg);
+      break;
+    case 'N' :
+      nnumbers = std::stol(optarg);
+      break;
+    case 'b' :
+      nblock = std::stoi(optarg);
+      break;
+    default:
+      show_help();
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if ( nthreads <= 0 || nnumbers <= 0 || nblock < 0 ) {
+    show_help();
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::vector<std::string> engines;
+  if ( engine_name == "" ) {
+    engines = RandomEngine::GetEngineNames();
+  } else {
+    auto engine = RandomEngine::Create(engine_name);
+    if ( engine == nullptr ) {
+      std::cout << "[ ERROR ] unknown random engine, "
+                << engine_name << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    delete engine;
+    engines.push_back(engine_name);
+  }
+
+  std::cout << "# threads = " << nthreads
+            << ", numbers/thread = " << nnumbers
+            << ", " << ( nblock > 0 ? "flatArray(" + std::to_string(nblock)
+                                      + ")" : std::string("flat()") )
+            << std::endl;
+  std::printf("%-10s %14s %14s %10s\n",
+              "engine", "M/s/thread", "M/s total", "ns/number");
+
+  // each thread runs its own engine, the slowest thread bounds the total
+  for ( const auto& name : engines ) {
+    std::vector<Result> results(nthreads);
+    std::vector<std::thread> threads;
+    for ( int i = 0; i < nthreads; i++ ) {
+      threads.emplace_back(::run_engine, name, i, nnumbers, nblock,
+                           std::ref(results[i]));
+    }
+    for ( auto& th : threads ) th.join();
+
+    double tsum = 0., tmax = 0., check = 0.;
+    for ( const auto& result : results ) {
+      tsum += result.seconds;
+      tmax = std::max(tmax, result.seconds);
+      check += result.sum;
+    }
+    double per_thread = nnumbers / ( tsum / nthreads ) * 1.e-6;
+    double total = nnumbers * double(nthreads) / tmax * 1.e-6;
+    double ns_per_number = tsum / nthreads / nnumbers * 1.e9;
+    std::printf("%-10s %14.2f %14.2f %10.2f\n",
+                name.c_str(), per_thread, total, ns_per_number);
+    if ( check < 0. ) std::cout << check << std::endl;  // keep the sums
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,514 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "G4ParticleTable.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include "common/appsetup.h"
+#include "common/energyspectrum.h"
+#include "common/eventaction.h"
+#include "common/eventdigest.h"
+#include "common/eventreader.h"
+#include "common/particlegun.h"
+#include "common/primaryaction.h"
+#include "common/randomengine.h"
+#include "common/runaction.h"
+#include "common/stackaction.h"
+#include "common/stepaction.h"
+#include "common/steptable.h"
+#include "util/benchreport.h"
+#include "util/jsonparser.h"
+#include "util/mempolicy.h"
+#include "util/profiler.h"
+#include "util/tracer.h"
+
+using namespace kut;
+
+// --------------------------------------------------------------------------
+namespace {
+
+JsonParser* jparser = nullptr;
+
+} // end of namespace
+
+// ==========================================================================
+AppSetup* AppSetup::GetAppSetup()
+{
+  static AppSetup appsetup;
+  return &appsetup;
+}
+
+// --------------------------------------------------------------------------
+AppSetup::AppSetup()
+  : run_mode_{"physics"}, run_seed_{0L}, qreproducible_{false},
+    event_reader_{nullptr},
+    energy_spectrum_{nullptr}, event_digest_{nullptr}, digest_file_{""},
+    event_capture_{nullptr}, capture_file_{""}, capture_threshold_{0.},
+    capture_percentile_{99.}, profile_file_{""},
+    trace_file_{""}, step_table_{nullptr}
+{
+  ::jparser = JsonParser::GetJsonParser();
+}
+
+// --------------------------------------------------------------------------
+AppSetup::~AppSetup()
+{
+  delete event_reader_;
+  delete energy_spectrum_;
+  delete [] event_digest_;
+  delete [] event_capture_;
+  delete [] step_table_;
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::SetupRandomEngine()
+{
+  if ( ! ::jparser-> Contains("Run/Engine") ) return;
+
+  auto name = ::jparser-> GetStringValue("Run/Engine");
+  if ( ! RandomEngine::SetEngine(name) ) {
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::SetupMemPolicy(char** argv)
+{
+  if ( ! ::jparser-> Contains("Run/Memory") ) return;
+
+  auto policy = MemPolicy::GetMemPolicy();
+
+  if ( ::jparser-> Contains("Run/Memory/thp") ) {
+    auto name = ::jparser-> GetStringValue("Run/Memory/thp");
+    if ( ! policy-> SetThp(name) ) {
+      std::cout << "[ ERROR ] AppSetup::SetupMemPolicy() "
+                 "invalid THP mode: " << name << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if ( ::jparser-> Contains("Run/Memory/arena_max") ) {
+    policy-> SetArenaMax(::jparser-> GetIntValue("Run/Memory/arena_max"));
+  }
+
+  if ( ::jparser-> Contains("Run/Memory/mmap_threshold") ) {
+    policy-> SetMmapThreshold(
+      ::jparser-> GetLongValue("Run/Memory/mmap_threshold"));
+  }
+
+  if ( ::jparser-> Contains("Run/Memory/numa") ) {
+    auto name = ::jparser-> GetStringValue("Run/Memory/numa");
+    if ( ! policy-> SetNuma(name) ) {
+      std::cout << "[ ERROR ] AppSetup::SetupMemPolicy() "
+                 "invalid NUMA policy: " << name << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if ( ::jparser-> Contains("Run/Memory/nodes") ) {
+    JsonParser::iarray_t nodes;
+    ::jparser-> GetIntArray("Run/Memory/nodes", nodes);
+    policy-> SetNumaNodes(nodes);
+  }
+
+  if ( ::jparser-> Contains("Run/Memory/workers") ) {
+    policy-> SetNumaWorkers(::jparser-> GetBoolValue("Run/Memory/workers"));
+  }
+
+  policy-> Apply(argv);
+  policy-> Report();
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::SetupSeeding()
+{
+  if ( ::jparser-> Contains("Run/Seed") ) {
+    run_seed_ = ::jparser-> GetLongValue("Run/Seed");
+  }
+  if ( ::jparser-> Contains("Run/Reproducible") ) {
+    qreproducible_ = ::jparser-> GetBoolValue("Run/Reproducible");
+  }
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::SeedRandomEngine() const
+{
+  auto luxury = RandomEngine::GetLuxury();
+  G4Random::setTheSeed(run_seed_, luxury);
+
+  // the configured name, Ranlux and Ranlux4 share a CLHEP class
+  auto name = RandomEngine::GetEngineName();
+  if ( name.empty() ) name = G4Random::getTheEngine()-> name();
+
+  auto report = BenchReport::GetBenchReport();
+  report-> SetString("rng/engine", name);
+  if ( luxury >= 0 ) report-> SetLong("rng/luxury", luxury);
+  report-> SetLong("rng/seed", run_seed_);
+  report-> SetBool("rng/reproducible", qreproducible_);
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::SetupRunMode()
+{
+  if ( ::jparser-> Contains("Run/Mode") ) {
+    run_mode_ = ::jparser-> GetStringValue("Run/Mode");
+  }
+  if ( run_mode_ != "physics" && run_mode_ != "geantino" &&
+       run_mode_ != "navigator" ) {
+    std::cout << "[ ERROR ] AppSetup::SetupRunMode() "
+                 "invalid run mode, " << run_mode_ << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  std::cout << "[ MESSAGE ] run mode : " << run_mode_ << std::endl;
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::StartEventReader()
+{
+  // one reader thread parsing ahead for all workers
+  if ( ! ::jparser-> Contains("Primary/type") ||
+       ::jparser-> GetStringValue("Primary/type") != "event" ) return;
+
+  event_reader_ = new EventReader();
+  if ( ::jparser-> Contains("Primary/Event/file") ) {
+    event_reader_->
+      SetFileName(::jparser-> GetStringValue("Primary/Event/file"));
+  }
+  if ( ::jparser-> Contains("Primary/Event/queue") ) {
+    event_reader_->
+      SetQueueSize(::jparser-> GetIntValue("Primary/Event/queue"));
+  }
+  if ( ::jparser-> Contains("Primary/Event/loop") ) {
+    event_reader_-> SetLoop(::jparser-> GetBoolValue("Primary/Event/loop"));
+  }
+
+  if ( ! event_reader_-> Start() ) {
+    std::exit(EXIT_FAILURE);
+  }
+  if ( qreproducible_ ) {
+    std::cout << "[ WARNING ] AppSetup::StartEventReader() input events "
+                 "are taken in arrival order, not reproducible over threads"
+              << std::endl;
+  }
+  if ( IsReplay() ) {
+    std::cout << "[ WARNING ] AppSetup::StartEventReader() input events "
+                 "are not replayed, only the engine state is" << std::endl;
+  }
+  std::cout << "[ MESSAGE ] primary type : event" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::LoadEnergySpectrum(const char* key)
+{
+  // loaded once by the master, shared or copied by threads
+  if ( ! ::jparser-> Contains(key) ) return;
+
+  auto fname = ::jparser-> GetStringValue(key);
+  energy_spectrum_ = new EnergySpectrum();
+  if ( ! energy_spectrum_-> Load(fname) ) {
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::cout << "[ MESSAGE ] energy spectrum : " << fname << " ("
+            << energy_spectrum_-> GetNbins() << " bins, mean = "
+            << energy_spectrum_-> GetMeanEnergy() / MeV << " MeV)"
+            << std::endl;
+  BenchReport::GetBenchReport()-> SetString("primary/spectrum", fname);
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::ConfigureParticleGun(ParticleGun* pga) const
+{
+  // distributions around the values set to the gun
+  if ( energy_spectrum_ != nullptr ) {
+    pga-> SetEnergySpectrum(*energy_spectrum_);
+  }
+
+  if ( ::jparser-> Contains("Primary/energy_spread") ) {
+    pga-> SetEnergySpread(::jparser-> GetDoubleValue("Primary/energy_spread"));
+  }
+
+  if ( ::jparser-> Contains("Primary/spot") ) {
+    int spot_type = ParticleGun::kGauss;
+    if ( ::jparser-> Contains("Primary/spot_type") ) {
+      auto stype = ::jparser-> GetStringValue("Primary/spot_type");
+      if ( stype == "flat" ) {
+        spot_type = ParticleGun::kFlat;
+      } else if ( stype != "gauss" ) {
+        std::cout << "[ ERROR ] AppSetup::ConfigureParticleGun() "
+                     "invalid beam spot type, " << stype << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    std::vector<double> dvec;
+    ::jparser-> GetDoubleArray("Primary/spot", dvec);
+    pga-> SetSpot(spot_type, dvec[0]*cm, dvec[1]*cm);
+  }
+
+  if ( ::jparser-> Contains("Primary/divergence") ) {
+    auto sigma = ::jparser-> GetDoubleValue("Primary/divergence");
+    pga-> SetDivergence(sigma * mrad);
+  }
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::SetupEventDigest(int nvec)
+{
+  // per-event digests for regression checks (needs a stacking action)
+  if ( ! ::jparser-> Contains("Run/Digest") ||
+       ! ::jparser-> GetBoolValue("Run/Digest") ) return;
+
+  event_digest_ = new EventDigest[nvec];
+  if ( ::jparser-> Contains("Run/DigestFile") ) {
+    digest_file_ = ::jparser-> GetStringValue("Run/DigestFile");
+  }
+  std::cout << "[ MESSAGE ] event digests : on" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+bool AppSetup::IsReplay() const
+{
+  return ::jparser-> Contains("Run/Replay");
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::SetupEventCapture(int nvec)
+{
+  // replay of captured events, instead of capturing
+  if ( IsReplay() ) {
+    auto fname = ::jparser-> GetStringValue("Run/Replay");
+    if ( ! EventCapture::Load(fname, replay_events_) ) {
+      std::exit(EXIT_FAILURE);
+    }
+    if ( replay_events_.empty() ) {
+      std::cout << "[ ERROR ] AppSetup::SetupEventCapture() "
+                   "no captured events in " << fname << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    std::cout << "[ MESSAGE ] replay : " << fname << " ("
+              << replay_events_.size() << " events)" << std::endl;
+    auto report = BenchReport::GetBenchReport();
+    report-> SetString("replay/file", fname);
+    report-> SetLong("replay/events", replay_events_.size());
+    return;
+  }
+
+  if ( ! ::jparser-> Contains("Run/Capture/output") ) return;
+
+  capture_file_ = ::jparser-> GetStringValue("Run/Capture/output");
+  if ( ::jparser-> Contains("Run/Capture/threshold") ) {
+    capture_threshold_ = ::jparser-> GetDoubleValue("Run/Capture/threshold");
+  }
+  if ( ::jparser-> Contains("Run/Capture/percentile") ) {
+    capture_percentile_ =
+      ::jparser-> GetDoubleValue("Run/Capture/percentile");
+  }
+
+  event_capture_ = new EventCapture[nvec];
+  if ( ::jparser-> Contains("Run/Capture/capacity") ) {
+    auto capacity = ::jparser-> GetIntValue("Run/Capture/capacity");
+    for ( int i = 0; i < nvec; i++ ) {
+      event_capture_[i].SetCapacity(capacity);
+    }
+  }
+  std::cout << "[ MESSAGE ] slow event capture : " << capture_file_
+            << std::endl;
+}
+
+// --------------------------------------------------------------------------
+int AppSetup::GetNhistories(int nhistories) const
+{
+  if ( ! IsReplay() ) return nhistories;
+
+  int nreplay = replay_events_.size();
+  if ( nhistories == 0 || nhistories > nreplay ) return nreplay;
+  return nhistories;
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::StartProfiler()
+{
+  if ( ! ::jparser-> Contains("Run/Profiler/output") ) return;
+
+  auto profiler = Profiler::GetProfiler();
+  if ( ::jparser-> Contains("Run/Profiler/frequency") ) {
+    profiler-> SetFrequency(::jparser-> GetIntValue("Run/Profiler/frequency"));
+  }
+  if ( ::jparser-> Contains("Run/Profiler/depth") ) {
+    profiler-> SetMaxDepth(::jparser-> GetIntValue("Run/Profiler/depth"));
+  }
+  if ( ::jparser-> Contains("Run/Profiler/buffer") ) {
+    profiler-> SetBufferSize(::jparser-> GetIntValue("Run/Profiler/buffer"));
+  }
+  if ( ::jparser-> Contains("Run/Profiler/unwind") ) {
+    auto unwind = ::jparser-> GetStringValue("Run/Profiler/unwind");
+    if ( unwind == "backtrace" ) {
+      profiler-> SetUnwind(Profiler::kBacktrace);
+    } else if ( unwind == "fp" ) {
+      profiler-> SetUnwind(Profiler::kFramePointer);
+    } else {
+      std::cout << "[ ERROR ] AppSetup::StartProfiler() "
+                   "invalid unwind type, " << unwind << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if ( ! profiler-> Start() ) return;
+  profiler-> RegisterThread();
+
+  profile_file_ = ::jparser-> GetStringValue("Run/Profiler/output");
+  std::cout << "[ MESSAGE ] sampling profiler : " << profile_file_
+            << " (" << profiler-> GetFrequency() << " Hz)" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::StartTracer()
+{
+  if ( ! ::jparser-> Contains("Run/Trace/output") ) return;
+
+  auto tracer = Tracer::GetTracer();
+  if ( ::jparser-> Contains("Run/Trace/buffer") ) {
+    tracer-> SetBufferSize(::jparser-> GetIntValue("Run/Trace/buffer"));
+  }
+  if ( ::jparser-> Contains("Run/Trace/sampling") ) {
+    tracer-> SetSampling(::jparser-> GetIntValue("Run/Trace/sampling"));
+  }
+  tracer-> Enable();
+  tracer-> SetThreadName("master");
+
+  trace_file_ = ::jparser-> GetStringValue("Run/Trace/output");
+  std::cout << "[ MESSAGE ] timeline trace : " << trace_file_
+            << " (every " << tracer-> GetSampling() << " events)"
+            << std::endl;
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::SetupStepTable(int nvec)
+{
+  if ( ! ::jparser-> Contains("Run/StepTable") ||
+       ! ::jparser-> GetBoolValue("Run/StepTable") ) return;
+
+  int sampling = 100;
+  if ( ::jparser-> Contains("Run/StepSampling") ) {
+    sampling = ::jparser-> GetIntValue("Run/StepSampling");
+  }
+
+  step_table_ = new StepTable[nvec];
+  for ( int i = 0; i < nvec; i++ ) {
+    step_table_[i].SetSampling(sampling);
+  }
+  std::cout << "[ MESSAGE ] step accounting : on (every " << sampling
+            << " steps timed)" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::ConfigureRunAction(RunAction* runaction) const
+{
+  runaction-> SetRunMode(run_mode_);
+  runaction-> SetEventReader(event_reader_);
+  runaction-> SetEventDigest(event_digest_, digest_file_);
+  if ( event_capture_ != nullptr ) {
+    runaction-> SetEventCapture(event_capture_, capture_file_,
+                                capture_threshold_, capture_percentile_);
+  }
+  runaction-> SetProfileFile(profile_file_);
+  runaction-> SetTraceFile(trace_file_);
+  runaction-> SetStepTable(step_table_);
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::ConfigureEventAction(EventAction* eventaction) const
+{
+  eventaction-> SetEventDigest(event_digest_);
+  eventaction-> SetEventCapture(event_capture_);
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::ConfigureStepAction(StepAction* stepaction) const
+{
+  stepaction-> SetStepTable(step_table_);
+}
+
+// --------------------------------------------------------------------------
+void AppSetup::ConfigurePrimaryAction(PrimaryAction* action) const
+{
+  if ( qreproducible_ ) action-> SetEventSeeding(run_seed_);
+  action-> SetEventCapture(event_capture_);
+  if ( ! replay_events_.empty() ) action-> SetReplay(&replay_events_);
+
+  if ( ! ::jparser-> Contains("Primary/pileup") ) return;
+
+  bool poisson = false;
+  if ( ::jparser-> Contains("Primary/pileup_poisson") ) {
+    poisson = ::jparser-> GetBoolValue("Primary/pileup_poisson");
+  }
+
+  // a fixed count is a whole number of overlays, a Poisson mean any
+  // positive value
+  auto pileup = ::jparser-> GetDoubleValue("Primary/pileup");
+  bool qvalid = poisson ? pileup > 0. :
+                          pileup >= 1. && pileup == std::floor(pileup);
+  if ( ! qvalid ) {
+    std::cout << "[ ERROR ] AppSetup::ConfigurePrimaryAction() "
+                 "invalid pileup, " << pileup << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  action-> SetPileup(pileup, poisson);
+
+  if ( ::jparser-> Contains("Primary/pileup_spread") ) {
+    std::vector<double> dvec;
+    ::jparser-> GetDoubleArray("Primary/pileup_spread", dvec);
+    action-> SetPileupSpread(dvec[0]*cm, dvec[1]*cm);
+  }
+}
+
+// --------------------------------------------------------------------------
+G4UserStackingAction* AppSetup::CreateStackAction(SimData* data) const
+{
+  if ( event_digest_ == nullptr && ! ::jparser-> Contains("Stacking") ) {
+    return nullptr;
+  }
+
+  auto stackaction = new StackAction();
+  stackaction-> SetSimData(data);
+
+  if ( ::jparser-> Contains("Stacking/waiting") ) {
+    std::vector<std::string> names;
+    ::jparser-> GetStringArray("Stacking/waiting", names);
+    auto particle_table = G4ParticleTable::GetParticleTable();
+    for ( const auto& name : names ) {
+      auto pdef = particle_table-> FindParticle(name);
+      if ( pdef == nullptr ) {
+        std::cout << "[ ERROR ] AppSetup::CreateStackAction() "
+                     "invalid particle name, " << name << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      stackaction-> AddWaitingParticle(pdef);
+    }
+  }
+  if ( ::jparser-> Contains("Stacking/waiting_energy") ) {
+    stackaction-> SetWaitingEnergy(
+      ::jparser-> GetDoubleValue("Stacking/waiting_energy") * MeV);
+  }
+  if ( ::jparser-> Contains("Stacking/kill_neutron") ) {
+    stackaction-> SetNeutronKillEnergy(
+      ::jparser-> GetDoubleValue("Stacking/kill_neutron") * MeV);
+  }
+  if ( ::jparser-> Contains("Stacking/kill_time") ) {
+    stackaction-> SetKillTime(
+      ::jparser-> GetDoubleValue("Stacking/kill_time") * ns);
+  }
+
+  return stackaction;
+}
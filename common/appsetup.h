@@ -0,0 +1,159 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef APP_SETUP_H_
+#define APP_SETUP_H_
+
+#include <string>
+#include <vector>
+#include "common/eventcapture.h"
+
+class G4UserStackingAction;
+class SimData;
+class EnergySpectrum;
+class EventAction;
+class EventDigest;
+class EventReader;
+class ParticleGun;
+class PrimaryAction;
+class RunAction;
+class StepAction;
+class StepTable;
+
+// components configured by the JSON config in the same way for all
+// applications, set up by the app builders
+class AppSetup {
+public:
+  static AppSetup* GetAppSetup();
+  ~AppSetup();
+
+  AppSetup(const AppSetup&) = delete;
+  AppSetup& operator=(const AppSetup&) = delete;
+
+  // Run/Engine : before run managers take it as the master engine
+  void SetupRandomEngine();
+  // Run/Memory : before large allocations, may re-execute the program
+  void SetupMemPolicy(char** argv);
+  // Run/Seed and Run/Reproducible, known before actions are built
+  // (serial mode builds them at SetUserInitialization)
+  void SetupSeeding();
+  long GetRunSeed() const;
+  bool IsReproducible() const;
+
+  // seeded at the luxury level of the engine, reported as rng/*
+  void SeedRandomEngine() const;
+
+  // Run/Mode : physics / geantino / navigator
+  void SetupRunMode();
+  const std::string& GetRunMode() const;
+
+  // Primary/type = event : reader thread started here, owned by this
+  void StartEventReader();
+  EventReader* GetEventReader() const;
+
+  // Primary/spectrum (or another key) : loaded once, owned by this
+  void LoadEnergySpectrum(const char* key = "Primary/spectrum");
+  EnergySpectrum* GetEnergySpectrum() const;
+
+  // energy / beam spot / angular distributions of the gun
+  void ConfigureParticleGun(ParticleGun* pga) const;
+
+  // Run/Digest : per-event digests of nvec threads, owned by this
+  void SetupEventDigest(int nvec);
+  EventDigest* GetEventDigest() const;
+
+  // Run/Replay : captured events replayed serially, known from the
+  // config at once. otherwise Run/Capture : slow events of nvec threads
+  bool IsReplay() const;
+  void SetupEventCapture(int nvec);
+  EventCapture* GetEventCapture() const;
+  // all captured events under replay, unless fewer are given
+  int GetNhistories(int nhistories) const;
+
+  // Run/Profiler : sampling profiler, the master here and workers at
+  // WorkerStart
+  void StartProfiler();
+
+  // Run/Trace : timelines of all threads, spans begin from here
+  void StartTracer();
+
+  // Run/StepTable : steps by volume / particle / process of nvec threads,
+  // owned by this
+  void SetupStepTable(int nvec);
+
+  // settings common to the master and worker run actions
+  void ConfigureRunAction(RunAction* runaction) const;
+  void ConfigureEventAction(EventAction* eventaction) const;
+  void ConfigureStepAction(StepAction* stepaction) const;
+
+  // with digests (tracks are counted) or Stacking, nullptr otherwise
+  G4UserStackingAction* CreateStackAction(SimData* data) const;
+
+  // pile-up, event seeding, capture and replay, in all applications
+  void ConfigurePrimaryAction(PrimaryAction* action) const;
+
+private:
+  AppSetup();
+
+  std::string run_mode_;
+  long run_seed_;
+  bool qreproducible_;
+  EventReader* event_reader_;
+  EnergySpectrum* energy_spectrum_;
+  EventDigest* event_digest_;
+  std::string digest_file_;
+  EventCapture* event_capture_;
+  std::string capture_file_;
+  double capture_threshold_;
+  double capture_percentile_;
+  std::vector<EventCapture::Entry> replay_events_;
+  std::string profile_file_;
+  std::string trace_file_;
+  StepTable* step_table_;
+
+};
+
+// ==========================================================================
+inline const std::string& AppSetup::GetRunMode() const
+{
+  return run_mode_;
+}
+
+inline long AppSetup::GetRunSeed() const
+{
+  return run_seed_;
+}
+
+inline bool AppSetup::IsReproducible() const
+{
+  return qreproducible_;
+}
+
+inline EventReader* AppSetup::GetEventReader() const
+{
+  return event_reader_;
+}
+
+inline EnergySpectrum* AppSetup::GetEnergySpectrum() const
+{
+  return energy_spectrum_;
+}
+
+inline EventDigest* AppSetup::GetEventDigest() const
+{
+  return event_digest_;
+}
+
+inline EventCapture* AppSetup::GetEventCapture() const
+{
+  return event_capture_;
+}
+
+#endif
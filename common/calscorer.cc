@@ -28,7 +28,9 @@ bool CalScorer::ProcessHits(G4Step* step, G4TouchableHistory*)
     tid = 0;
   }
 
-  auto edep = step-> GetTotalEnergyDeposit();
+  // weighted primaries (phase space), secondaries inherit the weight
+  auto edep = step-> GetTotalEnergyDeposit() *
+              step-> GetPreStepPoint()-> GetWeight();
   simdata_[tid].AddEdep(edep);
 
   return true;
@@ -0,0 +1,126 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include "common/energyspectrum.h"
+
+// --------------------------------------------------------------------------
+void EnergySpectrum::SetBins(const std::vector<double>& elow,
+                             const std::vector<double>& width,
+                             const std::vector<double>& weight)
+{
+  const int n = weight.size();
+  elow_ = elow;
+  width_ = width;
+  prob_.assign(n, 0.);
+  alias_.assign(n, 0);
+
+  double wsum = 0.;
+  mean_energy_ = 0.;
+  for ( int i = 0; i < n; i++ ) {
+    wsum += weight[i];
+    mean_energy_ += weight[i] * ( elow[i] + width[i]/2. );
+  }
+  mean_energy_ /= wsum;
+
+  // Vose's construction, scaled probabilities split into small/large
+  std::vector<double> scaled(n);
+  std::vector<int> small, large;
+  for ( int i = 0; i < n; i++ ) {
+    scaled[i] = weight[i] * n / wsum;
+    if ( scaled[i] < 1. ) small.push_back(i);
+    else large.push_back(i);
+  }
+
+  while ( ! small.empty() && ! large.empty() ) {
+    auto s = small.back(); small.pop_back();
+    auto l = large.back(); large.pop_back();
+    prob_[s] = scaled[s];
+    alias_[s] = l;
+    scaled[l] = ( scaled[l] + scaled[s] ) - 1.;
+    if ( scaled[l] < 1. ) small.push_back(l);
+    else large.push_back(l);
+  }
+
+  // remaining entries are 1 up to round-off
+  for ( auto i : large ) { prob_[i] = 1.; alias_[i] = i; }
+  for ( auto i : small ) { prob_[i] = 1.; alias_[i] = i; }
+}
+
+// --------------------------------------------------------------------------
+bool EnergySpectrum::Load(const std::string& fname)
+{
+  std::ifstream ifs(fname);
+  if ( ! ifs ) {
+    std::cout << "[ ERROR ] EnergySpectrum::Load() cannot open a file, "
+              << fname << std::endl;
+    return false;
+  }
+
+  std::vector<double> elow, width, weight;
+  std::string line;
+  int nline = 0;
+  while ( std::getline(ifs, line) ) {
+    nline++;
+    auto pos = line.find('#');
+    if ( pos != std::string::npos ) line.erase(pos);
+
+    std::istringstream iss(line);
+    double e0, e1, w;
+    if ( ! (iss >> e0) ) continue;  // blank line
+    if ( ! (iss >> e1 >> w) || e1 <= e0 || e0 < 0. || w < 0. ) {
+      std::cout << "[ ERROR ] EnergySpectrum::Load() invalid bin at line "
+                << nline << ", " << fname << std::endl;
+      return false;
+    }
+    elow.push_back(e0 * MeV);
+    width.push_back((e1 - e0) * MeV);
+    weight.push_back(w);
+  }
+
+  double wsum = 0.;
+  for ( auto w : weight ) wsum += w;
+  if ( wsum <= 0. ) {
+    std::cout << "[ ERROR ] EnergySpectrum::Load() empty spectrum, "
+              << fname << std::endl;
+    return false;
+  }
+
+  SetBins(elow, width, weight);
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+double EnergySpectrum::Sample() const
+{
+  auto u1 = G4UniformRand();
+  auto u2 = G4UniformRand();
+  return Sample(u1, u2);
+}
+
+// --------------------------------------------------------------------------
+double EnergySpectrum::Sample(double u1, double u2) const
+{
+  const int n = prob_.size();
+
+  // one random number picks the bin and the alias decision
+  double u = u1 * n;
+  int i = static_cast<int>(u);
+  if ( i >= n ) i = n - 1;
+  if ( u - i >= prob_[i] ) i = alias_[i];
+
+  // flat within the bin
+  return elow_[i] + width_[i] * u2;
+}
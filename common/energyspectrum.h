@@ -0,0 +1,59 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef ENERGY_SPECTRUM_H_
+#define ENERGY_SPECTRUM_H_
+
+#include <string>
+#include <vector>
+
+// binned energy spectrum sampled in O(1) by Walker's alias method.
+// built once, then shared read-only among threads or copied per thread.
+class EnergySpectrum {
+public:
+  EnergySpectrum() = default;
+  ~EnergySpectrum() = default;
+
+  // bins [elow, elow + width), weights need not be normalized
+  void SetBins(const std::vector<double>& elow,
+               const std::vector<double>& width,
+               const std::vector<double>& weight);
+
+  // text file, "e_low e_high weight" (MeV) per line, '#' for comments
+  bool Load(const std::string& fname);
+
+  double Sample() const;
+  // with given uniform random numbers in [0,1)
+  double Sample(double u1, double u2) const;
+
+  int GetNbins() const;
+  double GetMeanEnergy() const;
+
+private:
+  std::vector<double> elow_;
+  std::vector<double> width_;
+  std::vector<double> prob_;
+  std::vector<int> alias_;
+  double mean_energy_ {0.};
+
+};
+
+// ==========================================================================
+inline int EnergySpectrum::GetNbins() const
+{
+  return prob_.size();
+}
+
+inline double EnergySpectrum::GetMeanEnergy() const
+{
+  return mean_energy_;
+}
+
+#endif
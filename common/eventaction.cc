@@ -11,8 +11,13 @@ See the License for more information.
 #include <sstream>
 #include <string>
 #include "G4Event.hh"
+#include "G4Threading.hh"
 #include "common/eventaction.h"
+#include "common/eventcapture.h"
+#include "common/eventdigest.h"
+#include "common/simdata.h"
 #include "util/timehistory.h"
+#include "util/tracer.h"
 
 using namespace kut;
 
@@ -20,6 +25,7 @@ using namespace kut;
 namespace {
 
 TimeHistory* gtimer = nullptr;
+Tracer* tracer = nullptr;
 
 // --------------------------------------------------------------------------
 void ShowProgress(int nprocessed, const std::string& key)
@@ -32,9 +38,11 @@ void ShowProgress(int nprocessed, const std::string& key)
 
 // --------------------------------------------------------------------------
 EventAction::EventAction()
-  : check_counter_{1000}
+  : simdata_{nullptr}, check_counter_{1000}, digests_{nullptr},
+    captures_{nullptr}
 {
   ::gtimer = TimeHistory::GetTimeHistory();
+  ::tracer = Tracer::GetTracer();
 }
 
 // --------------------------------------------------------------------------
@@ -44,6 +52,24 @@ void EventAction::BeginOfEventAction(const G4Event* event)
   if ( ievent == 0 ) {
     ::gtimer-> TakeSplit("FirstEventStart");
   }
+
+  if ( ::tracer-> IsSampled(ievent) ) ::tracer-> Begin("event", ievent);
+
+  auto tid = G4Threading::G4GetThreadId();
+
+  if ( tid == G4Threading::MASTER_ID) {
+    tid = 0;
+  }
+
+  if ( simdata_[tid].GetFirstEventTime() < 0. ) {
+    simdata_[tid].SetFirstEventTime(::gtimer-> GetElapsed());
+  }
+
+  if ( digests_ != nullptr ) {
+    digests_[tid].BeginEvent(simdata_[tid].GetStepCount(),
+                             simdata_[tid].GetEdepQuanta(),
+                             simdata_[tid].GetTrackCount());
+  }
 }
 
 // --------------------------------------------------------------------------
@@ -52,6 +78,25 @@ void EventAction::EndOfEventAction(const G4Event* event)
   auto ievent = event-> GetEventID();
   constexpr int kKiloEvents = 1000;
 
+  auto tid = G4Threading::G4GetThreadId();
+
+  if ( tid == G4Threading::MASTER_ID) {
+    tid = 0;
+  }
+
+  // opened in primary generation
+  simdata_[tid].EndEventAlloc();
+
+  if ( captures_ != nullptr ) captures_[tid].EndEvent(ievent);
+
+  if ( ::tracer-> IsSampled(ievent) ) ::tracer-> End();
+
+  if ( digests_ != nullptr ) {
+    digests_[tid].EndEvent(ievent, simdata_[tid].GetStepCount(),
+                           simdata_[tid].GetEdepQuanta(),
+                           simdata_[tid].GetTrackCount());
+  }
+
   if ( ievent % check_counter_ == 0 && ievent != 0 ) {
     int event_in_kilo = ievent / kKiloEvents;
     std::stringstream key;
@@ -13,25 +13,50 @@ See the License for more information.
 
 #include "G4UserEventAction.hh"
 
+class EventCapture;
+class EventDigest;
+class SimData;
+
 class EventAction : public G4UserEventAction {
 public:
   EventAction();
   ~EventAction() override = default;
 
+  void SetSimData(SimData* data);
   void SetCheckCounter(int val);
+  void SetEventDigest(EventDigest* digests);
+  void SetEventCapture(EventCapture* captures);
 
   void BeginOfEventAction(const G4Event* event) override;
   void EndOfEventAction(const G4Event* event) override;
 
 private:
+  SimData* simdata_;
   int check_counter_;
+  EventDigest* digests_;
+  EventCapture* captures_;
 
 };
 
 // ==========================================================================
+inline void EventAction::SetSimData(SimData* data)
+{
+  simdata_ = data;
+}
+
 inline void EventAction::SetCheckCounter(int val)
 {
   check_counter_ = val;
 }
 
+inline void EventAction::SetEventDigest(EventDigest* digests)
+{
+  digests_ = digests;
+}
+
+inline void EventAction::SetEventCapture(EventCapture* captures)
+{
+  captures_ = captures;
+}
+
 #endif
@@ -0,0 +1,199 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include "Randomize.hh"
+#include "common/eventcapture.h"
+
+// --------------------------------------------------------------------------
+namespace {
+
+const char* kHeader = "# g4bench slow events";
+const char* kEndTag = "event-end";
+
+// --------------------------------------------------------------------------
+bool LaterFirst(const EventCapture::Entry& a, const EventCapture::Entry& b)
+{
+  return a.time > b.time;
+}
+
+} // end of namespace
+
+// ==========================================================================
+EventCapture::EventCapture()
+  : capacity_{100}
+{
+}
+
+// --------------------------------------------------------------------------
+void EventCapture::Clear()
+{
+  times_.clear();
+  entries_.clear();
+}
+
+// --------------------------------------------------------------------------
+void EventCapture::BeginEvent()
+{
+  state_.str("");
+  state_.clear();
+  G4Random::saveFullState(state_);
+
+  t0_ = n_clock::now();
+}
+
+// --------------------------------------------------------------------------
+void EventCapture::EndEvent(int event_id)
+{
+  double time = std::chrono::duration<double, std::milli>
+                (n_clock::now() - t0_).count();
+  times_.push_back(time);
+
+  if ( capacity_ <= 0 ) return;
+
+  // heap top is the fastest event kept
+  if ( static_cast<int>(entries_.size()) < capacity_ ) {
+    entries_.push_back({event_id, time, state_.str()});
+    std::push_heap(entries_.begin(), entries_.end(), ::LaterFirst);
+  } else if ( time > entries_.front().time ) {
+    std::pop_heap(entries_.begin(), entries_.end(), ::LaterFirst);
+    auto& entry = entries_.back();
+    entry.event_id = event_id;
+    entry.time = time;
+    entry.state = state_.str();
+    std::push_heap(entries_.begin(), entries_.end(), ::LaterFirst);
+  }
+}
+
+// --------------------------------------------------------------------------
+int EventCapture::Write(const EventCapture* captures, int ncaptures,
+                        const std::string& fname,
+                        double threshold, double percentile, double& cut)
+{
+  std::vector<double> times;
+  std::vector<const Entry*> entries;
+  for ( int i = 0; i < ncaptures; i++ ) {
+    const auto& tvec = captures[i].GetTimes();
+    times.insert(times.end(), tvec.begin(), tvec.end());
+    for ( const auto& entry : captures[i].GetEntries() ) {
+      entries.push_back(&entry);
+    }
+  }
+
+  // nearest-rank percentile over all events
+  cut = threshold;
+  if ( percentile > 0. && ! times.empty() ) {
+    std::sort(times.begin(), times.end());
+    int idx = static_cast<int>(std::ceil(percentile / 100. * times.size()));
+    idx = std::min(std::max(idx - 1, 0), static_cast<int>(times.size()) - 1);
+    cut = std::max(cut, times[idx]);
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry* a, const Entry* b) { return a-> time > b-> time; });
+  auto nslow = std::count_if(times.begin(), times.end(),
+                             [cut](double t) { return t >= cut; });
+
+  std::ofstream ofs(fname, std::ios::out);
+  if ( ! ofs ) {
+    std::cout << "[ WARNING ] EventCapture::Write() "
+                 "cannot open a capture file, " << fname << std::endl;
+    return 0;
+  }
+
+  ofs << ::kHeader << std::endl;
+  int nwritten = 0;
+  for ( auto entry : entries ) {
+    if ( entry-> time < cut ) break;
+    ofs << "event " << entry-> event_id << " " << entry-> time << std::endl
+        << entry-> state
+        << ::kEndTag << std::endl;
+    nwritten++;
+  }
+  ofs.close();
+
+  if ( nwritten < nslow ) {
+    std::cout << "[ WARNING ] EventCapture::Write() "
+              << nslow - nwritten << " slow events are not captured, "
+                 "raise the capture capacity" << std::endl;
+  }
+
+  return nwritten;
+}
+
+// --------------------------------------------------------------------------
+bool EventCapture::Load(const std::string& fname, std::vector<Entry>& entries)
+{
+  std::ifstream ifs(fname, std::ios::in);
+  if ( ! ifs ) {
+    std::cout << "[ ERROR ] EventCapture::Load() "
+                 "cannot open a capture file, " << fname << std::endl;
+    return false;
+  }
+
+  std::string line;
+  std::getline(ifs, line);
+  if ( line != ::kHeader ) {
+    std::cout << "[ ERROR ] EventCapture::Load() "
+                 "not a capture file, " << fname << std::endl;
+    return false;
+  }
+
+  entries.clear();
+  while ( std::getline(ifs, line) ) {
+    if ( line.empty() ) continue;
+
+    Entry entry;
+    std::string tag;
+    std::istringstream iss(line);
+    iss >> tag >> entry.event_id >> entry.time;
+    if ( iss.fail() || tag != "event" ) {
+      std::cout << "[ ERROR ] EventCapture::Load() "
+                   "invalid entry, " << line << std::endl;
+      return false;
+    }
+
+    bool qend = false;
+    while ( std::getline(ifs, line) ) {
+      if ( line == ::kEndTag ) {
+        qend = true;
+        break;
+      }
+      entry.state += line + "\n";
+    }
+    if ( ! qend ) {
+      std::cout << "[ ERROR ] EventCapture::Load() "
+                   "truncated entry of event " << entry.event_id << std::endl;
+      return false;
+    }
+    entries.push_back(entry);
+  }
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool EventCapture::Restore(const Entry& entry)
+{
+  std::istringstream iss(entry.state);
+  G4Random::restoreFullState(iss);
+
+  if ( iss.fail() ) {
+    std::cout << "[ ERROR ] EventCapture::Restore() "
+                 "engine state of event " << entry.event_id
+              << " is not for " << G4Random::getTheEngine()-> name()
+              << std::endl;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,87 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef EVENT_CAPTURE_H_
+#define EVENT_CAPTURE_H_
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// capture of slow events for one thread (one per thread). the engine
+// state is saved before primary generation and kept for the slowest
+// events, so that they can be replayed one by one.
+class alignas(64) EventCapture {
+public:
+  struct Entry {
+    int event_id;
+    double time;  // ms
+    std::string state;
+  };
+
+  EventCapture();
+  ~EventCapture() = default;
+
+  EventCapture(const EventCapture&) = delete;
+  EventCapture& operator=(const EventCapture&) = delete;
+
+  // max #events kept (slowest first)
+  void SetCapacity(int n);
+
+  void Clear();
+
+  void BeginEvent();
+  void EndEvent(int event_id);
+
+  const std::vector<double>& GetTimes() const;
+  const std::vector<Entry>& GetEntries() const;
+
+  // events of all threads slower than max(threshold, percentile cut),
+  // written in descending order of time. returns #events written.
+  static int Write(const EventCapture* captures, int ncaptures,
+                   const std::string& fname,
+                   double threshold, double percentile, double& cut);
+
+  static bool Load(const std::string& fname, std::vector<Entry>& entries);
+
+  // restores the engine of the current thread
+  static bool Restore(const Entry& entry);
+
+private:
+  using n_clock = std::chrono::steady_clock;
+
+  int capacity_;
+  std::vector<double> times_;
+  std::vector<Entry> entries_;  // min-heap of time
+
+  std::ostringstream state_;
+  n_clock::time_point t0_;
+
+};
+
+// ==========================================================================
+inline void EventCapture::SetCapacity(int n)
+{
+  capacity_ = n;
+}
+
+inline const std::vector<double>& EventCapture::GetTimes() const
+{
+  return times_;
+}
+
+inline const std::vector<EventCapture::Entry>&
+  EventCapture::GetEntries() const
+{
+  return entries_;
+}
+
+#endif
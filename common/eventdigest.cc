@@ -0,0 +1,102 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+#include "common/eventdigest.h"
+
+// --------------------------------------------------------------------------
+namespace {
+
+// splitmix64 finalizer
+uint64_t mix(uint64_t z)
+{
+  z += 0x9e3779b97f4a7c15ULL;
+  z = ( z ^ (z >> 30) ) * 0xbf58476d1ce4e5b9ULL;
+  z = ( z ^ (z >> 27) ) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+} // end of namespace
+
+// ==========================================================================
+EventDigest::EventDigest()
+  : nsteps0_{0}, edep0_{0}, ntracks0_{0}
+{
+}
+
+// --------------------------------------------------------------------------
+void EventDigest::Clear()
+{
+  records_.clear();
+  nsteps0_ = edep0_ = ntracks0_ = 0;
+}
+
+// --------------------------------------------------------------------------
+void EventDigest::EndEvent(int64_t event_id,
+                           int64_t nsteps, int64_t edep, int64_t ntracks)
+{
+  Record record;
+  record.event_id = event_id;
+  record.nsteps = nsteps - nsteps0_;
+  record.edep = edep - edep0_;
+  record.ntracks = ntracks - ntracks0_;
+
+  uint64_t h = ::mix(record.event_id);
+  h = ::mix(h ^ record.nsteps);
+  h = ::mix(h ^ record.edep);
+  h = ::mix(h ^ record.ntracks);
+  record.digest = h;
+
+  records_.push_back(record);
+}
+
+// --------------------------------------------------------------------------
+uint64_t EventDigest::Merge(const EventDigest* digests, int ndigests,
+                            const std::string& fname, int64_t& nevents)
+{
+  std::vector<Record> records;
+  for ( int i = 0; i < ndigests; i++ ) {
+    const auto& vec = digests[i].GetRecords();
+    records.insert(records.end(), vec.begin(), vec.end());
+  }
+  std::sort(records.begin(), records.end(),
+            [](const Record& a, const Record& b) {
+              return a.event_id < b.event_id;
+            });
+
+  // chained in event order, independent of threads
+  uint64_t fingerprint = ::mix(records.size());
+  for ( const auto& record : records ) {
+    fingerprint = ::mix(fingerprint ^ record.digest);
+  }
+  nevents = records.size();
+
+  if ( fname != "" ) {
+    auto fp = std::fopen(fname.c_str(), "w");
+    if ( fp == nullptr ) {
+      std::cout << "[ WARNING ] EventDigest::Merge() "
+                   "cannot open a digest file, " << fname << std::endl;
+      return fingerprint;
+    }
+    std::fprintf(fp, "# event steps edep(eV) tracks digest\n");
+    for ( const auto& record : records ) {
+      std::fprintf(fp, "%" PRId64 " %" PRId64 " %" PRId64 " %" PRId64
+                   " %016" PRIx64 "\n",
+                   record.event_id, record.nsteps, record.edep,
+                   record.ntracks, record.digest);
+    }
+    std::fclose(fp);
+  }
+
+  return fingerprint;
+}
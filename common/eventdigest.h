@@ -0,0 +1,72 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef EVENT_DIGEST_H_
+#define EVENT_DIGEST_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// per-event digests of #steps, edep (fixed point) and #tracks,
+// buffered for one thread (cache-line aligned, one per thread)
+class alignas(64) EventDigest {
+public:
+  struct Record {
+    int64_t event_id;
+    int64_t nsteps;
+    int64_t edep;  // in SimData::kEdepQuantum
+    int64_t ntracks;
+    uint64_t digest;
+  };
+
+  EventDigest();
+  ~EventDigest() = default;
+
+  EventDigest(const EventDigest&) = delete;
+  EventDigest& operator=(const EventDigest&) = delete;
+
+  void Clear();
+
+  // thread counters at the beginning / end of an event
+  void BeginEvent(int64_t nsteps, int64_t edep, int64_t ntracks);
+  void EndEvent(int64_t event_id,
+                int64_t nsteps, int64_t edep, int64_t ntracks);
+
+  const std::vector<Record>& GetRecords() const;
+
+  // records of all threads in event order, written to a text file if
+  // fname is given. returns the run fingerprint.
+  static uint64_t Merge(const EventDigest* digests, int ndigests,
+                        const std::string& fname, int64_t& nevents);
+
+private:
+  std::vector<Record> records_;
+  int64_t nsteps0_;
+  int64_t edep0_;
+  int64_t ntracks0_;
+
+};
+
+// ==========================================================================
+inline void EventDigest::BeginEvent(int64_t nsteps, int64_t edep,
+                                    int64_t ntracks)
+{
+  nsteps0_ = nsteps;
+  edep0_ = edep;
+  ntracks0_ = ntracks;
+}
+
+inline const std::vector<EventDigest::Record>& EventDigest::GetRecords() const
+{
+  return records_;
+}
+
+#endif
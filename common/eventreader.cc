@@ -0,0 +1,211 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include "common/eventreader.h"
+#include "util/benchreport.h"
+
+using namespace kut;
+
+// --------------------------------------------------------------------------
+namespace {
+
+// back-off of the reader while the queue is full
+const auto kFullPoll = std::chrono::microseconds(100);
+
+// a malformed input is fatal, not taken as the end of input
+[[noreturn]] void ParseError(const std::string& fname, long ievent,
+                             const char* what)
+{
+  std::cout << "[ ERROR ] EventReader::ReadEvent() " << what
+            << " in event #" << ievent << ", " << fname << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+} // end of namespace
+
+// ==========================================================================
+EventReader::EventReader()
+  : fname_{"events.hepevt"}, queue_size_{1024}, qloop_{true},
+    input_{nullptr}, qstop_{false}, qfinished_{false},
+    nevents_{0}, nparticles_{0}, nfull_{0}, nempty_{0}, read_time_{0.}
+{
+}
+
+// --------------------------------------------------------------------------
+EventReader::~EventReader()
+{
+  Stop();
+}
+
+// --------------------------------------------------------------------------
+bool EventReader::Start()
+{
+  Stop();
+
+  if ( fname_ == "-" ) {
+    input_ = &std::cin;
+  } else {
+    file_.open(fname_);
+    if ( ! file_ ) {
+      std::cout << "[ ERROR ] EventReader::Start() cannot open an event file, "
+                << fname_ << std::endl;
+      return false;
+    }
+    input_ = &file_;
+  }
+
+  queue_.reset(new MPMCQueue<HepEvent*>(queue_size_));
+  qstop_ = false;
+  qfinished_ = false;
+
+  thread_ = std::thread(&EventReader::Loop, this);
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void EventReader::Stop()
+{
+  if ( ! thread_.joinable() ) return;
+
+  qstop_ = true;
+  thread_.join();
+
+  HepEvent* event;
+  while ( queue_-> Pop(event) ) delete event;
+
+  if ( file_.is_open() ) file_.close();
+  input_ = nullptr;
+}
+
+// --------------------------------------------------------------------------
+HepEvent* EventReader::ReadEvent()
+{
+  std::string line;
+
+  // NHEP, blank lines skipped. nullptr only at the end of input
+  bool qfound = false;
+  while ( std::getline(*input_, line) ) {
+    if ( line.find_first_not_of(" \t\r") == std::string::npos ) continue;
+    qfound = true;
+    break;
+  }
+  if ( ! qfound ) return nullptr;
+
+  char* end;
+  long nhep = std::strtol(line.c_str(), &end, 10);
+  if ( end == line.c_str() || nhep < 0 ) {
+    ::ParseError(fname_, nevents_ + 1, "bad NHEP");
+  }
+
+  auto event = new HepEvent();
+  event-> reserve(nhep);
+
+  for ( long i = 0; i < nhep; i++ ) {
+    if ( ! std::getline(*input_, line) ) {
+      ::ParseError(fname_, nevents_ + 1, "truncated event");
+    }
+
+    const char* p = line.c_str();
+    long isthep = std::strtol(p, &end, 10); p = end;
+    long idhep = std::strtol(p, &end, 10); p = end;
+    std::strtol(p, &end, 10); p = end;  // JDAHEP1
+    std::strtol(p, &end, 10); p = end;  // JDAHEP2
+
+    HepParticle particle;
+    particle.pdg = idhep;
+    particle.px = std::strtod(p, &end); p = end;
+    particle.py = std::strtod(p, &end); p = end;
+    particle.pz = std::strtod(p, &end); p = end;
+    particle.mass = std::strtod(p, &end);
+    if ( end == p ) ::ParseError(fname_, nevents_ + 1, "bad particle line");
+
+    // final state particles only
+    if ( isthep == 1 ) event-> push_back(particle);
+  }
+
+  return event;
+}
+
+// --------------------------------------------------------------------------
+void EventReader::Loop()
+{
+  while ( ! qstop_.load(std::memory_order_relaxed) ) {
+    auto t0 = std::chrono::steady_clock::now();
+    auto event = ReadEvent();
+    // end of input, parse errors never come back here
+    if ( event == nullptr && qloop_ && input_ == &file_ && nevents_ > 0 ) {
+      file_.clear();
+      file_.seekg(0);
+      event = ReadEvent();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    read_time_.store(read_time_.load(std::memory_order_relaxed) +
+                     std::chrono::duration<double>(t1 - t0).count(),
+                     std::memory_order_relaxed);
+
+    if ( event == nullptr ) break;
+    nevents_.fetch_add(1, std::memory_order_relaxed);
+    nparticles_.fetch_add(event-> size(), std::memory_order_relaxed);
+
+    // a full queue means the workers are the bottleneck
+    bool qwaited = false;
+    while ( ! queue_-> Push(event) ) {
+      if ( qstop_.load(std::memory_order_relaxed) ) {
+        delete event;
+        break;
+      }
+      if ( ! qwaited ) {
+        nfull_.fetch_add(1, std::memory_order_relaxed);
+        qwaited = true;
+      }
+      std::this_thread::sleep_for(::kFullPoll);
+    }
+  }
+
+  qfinished_.store(true, std::memory_order_release);
+}
+
+// --------------------------------------------------------------------------
+HepEvent* EventReader::Pop()
+{
+  HepEvent* event;
+  bool qwaited = false;
+  while ( true ) {
+    if ( queue_-> Pop(event) ) return event;
+
+    // the last events may be pushed just before the reader finishes
+    if ( qfinished_.load(std::memory_order_acquire) ) {
+      return queue_-> Pop(event) ? event : nullptr;
+    }
+
+    // an empty queue means the reader is the bottleneck
+    if ( ! qwaited ) {
+      nempty_.fetch_add(1, std::memory_order_relaxed);
+      qwaited = true;
+    }
+    std::this_thread::yield();
+  }
+}
+
+// --------------------------------------------------------------------------
+void EventReader::Report() const
+{
+  auto report = BenchReport::GetBenchReport();
+  report-> SetString("primary/event_file", fname_);
+  report-> SetLong("primary/reader_events", nevents_);
+  report-> SetLong("primary/reader_particles", nparticles_);
+  report-> SetDouble("primary/reader_time", read_time_);
+  report-> SetLong("primary/reader_queue_full", nfull_);
+  report-> SetLong("primary/reader_queue_empty", nempty_);
+}
@@ -0,0 +1,99 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef EVENT_READER_H_
+#define EVENT_READER_H_
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "util/mpmcqueue.h"
+
+// final state particle of an input event, momentum and mass in GeV
+struct HepParticle {
+  int pdg;
+  double px, py, pz;
+  double mass;
+};
+
+using HepEvent = std::vector<HepParticle>;
+
+// background reader parsing HEPEvt ASCII events from a file or a pipe
+// ("-" for stdin) ahead of the workers, through a lock-free queue.
+//
+//   NHEP
+//   ISTHEP IDHEP JDAHEP1 JDAHEP2 PHEP1 PHEP2 PHEP3 PHEP5   (x NHEP)
+//
+class EventReader {
+public:
+  EventReader();
+  ~EventReader();
+
+  EventReader(const EventReader&) = delete;
+  EventReader& operator=(const EventReader&) = delete;
+
+  void SetFileName(const std::string& fname);
+  void SetQueueSize(std::size_t n);
+  // rewind a regular file at the end
+  void SetLoop(bool val);
+
+  bool Start();
+  void Stop();
+
+  // next event owned by the caller, nullptr once the input is over
+  HepEvent* Pop();
+
+  // reader statistics as primary/reader_*
+  void Report() const;
+
+private:
+  std::string fname_;
+  std::size_t queue_size_;
+  bool qloop_;
+
+  std::ifstream file_;
+  std::istream* input_;
+  std::unique_ptr<kut::MPMCQueue<HepEvent*>> queue_;
+  std::thread thread_;
+  std::atomic<bool> qstop_;
+  std::atomic<bool> qfinished_;
+
+  // statistics
+  std::atomic<long> nevents_;
+  std::atomic<long> nparticles_;
+  std::atomic<long> nfull_;
+  std::atomic<long> nempty_;
+  std::atomic<double> read_time_;
+
+  void Loop();
+  HepEvent* ReadEvent();
+
+};
+
+// ==========================================================================
+inline void EventReader::SetFileName(const std::string& fname)
+{
+  fname_ = fname;
+}
+
+inline void EventReader::SetQueueSize(std::size_t n)
+{
+  queue_size_ = n;
+}
+
+inline void EventReader::SetLoop(bool val)
+{
+  qloop_ = val;
+}
+
+#endif
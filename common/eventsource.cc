@@ -0,0 +1,68 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <iostream>
+#include "G4Event.hh"
+#include "G4ParticleTable.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4RunManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "common/eventreader.h"
+#include "common/eventsource.h"
+
+// --------------------------------------------------------------------------
+EventSource::EventSource()
+  : reader_{nullptr}
+{
+}
+
+// --------------------------------------------------------------------------
+G4ParticleDefinition* EventSource::FindParticle(int pdg)
+{
+  auto itr = particle_cache_.find(pdg);
+  if ( itr != particle_cache_.end() ) return itr-> second;
+
+  // unknown particles are skipped (nullptr cached)
+  auto particle = G4ParticleTable::GetParticleTable()-> FindParticle(pdg);
+  if ( particle == nullptr ) {
+    std::cout << "[ WARNING ] EventSource::FindParticle() "
+                 "unknown PDG code skipped, " << pdg << std::endl;
+  }
+  particle_cache_[pdg] = particle;
+
+  return particle;
+}
+
+// --------------------------------------------------------------------------
+void EventSource::GeneratePrimaries(G4Event* event)
+{
+  auto hep_event = reader_-> Pop();
+  if ( hep_event == nullptr ) {
+    std::cout << "[ WARNING ] EventSource::GeneratePrimaries() "
+                 "no more input events, run aborted" << std::endl;
+    G4RunManager::GetRunManager()-> AbortRun(true);
+    return;
+  }
+
+  auto vertex = new G4PrimaryVertex(position_, 0.);
+  for ( const auto& hep : *hep_event ) {
+    auto particle = FindParticle(hep.pdg);
+    if ( particle == nullptr ) continue;
+
+    auto primary = new G4PrimaryParticle(particle, hep.px * GeV,
+                                         hep.py * GeV, hep.pz * GeV);
+    primary-> SetMass(hep.mass * GeV);
+    vertex-> SetPrimary(primary);
+  }
+  event-> AddPrimaryVertex(vertex);
+
+  delete hep_event;
+}
@@ -0,0 +1,56 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef EVENT_SOURCE_H_
+#define EVENT_SOURCE_H_
+
+#include <map>
+#include "G4ThreeVector.hh"
+#include "G4VUserPrimaryGeneratorAction.hh"
+
+class G4ParticleDefinition;
+class EventReader;
+
+// primary generator taking multi-particle events from a shared reader
+class EventSource : public G4VUserPrimaryGeneratorAction {
+public:
+  EventSource();
+  ~EventSource() override = default;
+
+  EventSource(const EventSource&) = delete;
+  void operator=(const EventSource&) = delete;
+
+  void SetEventReader(EventReader* reader);
+  void SetPosition(const G4ThreeVector& pos);
+
+  void GeneratePrimaries(G4Event* event) override;
+
+private:
+  EventReader* reader_;
+  G4ThreeVector position_;
+
+  std::map<int, G4ParticleDefinition*> particle_cache_;
+
+  G4ParticleDefinition* FindParticle(int pdg);
+
+};
+
+// ==========================================================================
+inline void EventSource::SetEventReader(EventReader* reader)
+{
+  reader_ = reader;
+}
+
+inline void EventSource::SetPosition(const G4ThreeVector& pos)
+{
+  position_ = pos;
+}
+
+#endif
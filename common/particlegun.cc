@@ -8,12 +8,16 @@ This software is distributed WITHOUT ANY WARRANTY; without even the
 implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
 See the License for more information.
 ============================================================================*/
+#include <cmath>
 #include "G4ParticleGun.hh"
+#include "Randomize.hh"
 #include "common/particlegun.h"
 
 // --------------------------------------------------------------------------
 ParticleGun::ParticleGun()
-  : gun_{nullptr}
+  : gun_{nullptr}, energy_spread_{0.}, spot_type_{kGauss},
+    spot_x_{0.}, spot_y_{0.}, divergence_{0.},
+    qnominal_{false}, energy_{0.}, last_energy_{0.}
 {
   gun_ = new G4ParticleGun();
 }
@@ -27,5 +31,66 @@ ParticleGun::~ParticleGun()
 // --------------------------------------------------------------------------
 void ParticleGun::GeneratePrimaries(G4Event* event)
 {
+  if ( ! HasDistributions() ) {
+    gun_-> GeneratePrimaryVertex(event);
+    return;
+  }
+
+  UpdateNominal();
+
+  // energy
+  double ekin = energy_;
+  if ( spectrum_.GetNbins() > 0 ) {
+    ekin = spectrum_.Sample();
+  } else if ( energy_spread_ > 0. ) {
+    do {
+      ekin = G4RandGauss::shoot(energy_, energy_spread_ * energy_);
+    } while ( ekin <= 0. );
+  }
+  gun_-> SetParticleEnergy(ekin);
+
+  // beam spot, in the plane normal to the nominal direction
+  if ( spot_x_ > 0. || spot_y_ > 0. ) {
+    double dx, dy;
+    if ( spot_type_ == kFlat ) {
+      dx = ( G4UniformRand() - 0.5 ) * spot_x_;
+      dy = ( G4UniformRand() - 0.5 ) * spot_y_;
+    } else {
+      dx = G4RandGauss::shoot(0., spot_x_);
+      dy = G4RandGauss::shoot(0., spot_y_);
+    }
+    G4ThreeVector offset(dx, dy, 0.);
+    offset.rotateUz(direction_);
+    gun_-> SetParticlePosition(position_ + offset);
+  }
+
+  // angular spread around the nominal direction
+  if ( divergence_ > 0. ) {
+    double tx = std::tan(G4RandGauss::shoot(0., divergence_));
+    double ty = std::tan(G4RandGauss::shoot(0., divergence_));
+    G4ThreeVector dir = G4ThreeVector(tx, ty, 1.).unit();
+    dir.rotateUz(direction_);
+    gun_-> SetParticleMomentumDirection(dir);
+  }
+
   gun_-> GeneratePrimaryVertex(event);
+
+  last_energy_ = gun_-> GetParticleEnergy();
+  last_position_ = gun_-> GetParticlePosition();
+  last_direction_ = gun_-> GetParticleMomentumDirection();
+}
+
+// --------------------------------------------------------------------------
+void ParticleGun::UpdateNominal()
+{
+  // a value differing from the one left by the last event has been set
+  // from outside, and becomes nominal
+  auto energy = gun_-> GetParticleEnergy();
+  auto position = gun_-> GetParticlePosition();
+  auto direction = gun_-> GetParticleMomentumDirection();
+
+  if ( ! qnominal_ || energy != last_energy_ ) energy_ = energy;
+  if ( ! qnominal_ || position != last_position_ ) position_ = position;
+  if ( ! qnominal_ || direction != last_direction_ ) direction_ = direction;
+  qnominal_ = true;
 }
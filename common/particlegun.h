@@ -11,10 +11,16 @@ See the License for more information.
 #ifndef PARTICLE_GUN_H_
 #define PARTICLE_GUN_H_
 
+#include "G4ThreeVector.hh"
 #include "G4VUserPrimaryGeneratorAction.hh"
+#include "common/energyspectrum.h"
 
 class G4ParticleGun;
 
+// particle gun with optional energy, beam spot and angular distributions
+// around the energy / position / direction set to the gun. nominal values
+// are taken from the gun at the first event, and again whenever the gun
+// has been changed since the last event (e.g. by /gun/ commands).
 class ParticleGun : public G4VUserPrimaryGeneratorAction {
 public:
   ParticleGun();
@@ -23,13 +29,44 @@ public:
   ParticleGun(const ParticleGun&) = delete;
   void operator=(const ParticleGun&) = delete;
 
+  // beam spot profile
+  enum { kGauss = 0, kFlat };
+
   G4ParticleGun* GetGun() const;
 
+  // energy table, copied for this thread
+  void SetEnergySpectrum(const EnergySpectrum& spectrum);
+  // Gaussian energy spread relative to the nominal energy
+  void SetEnergySpread(double val);
+  // sigma (kGauss) or full width (kFlat) across the beam direction
+  void SetSpot(int type, double sx, double sy);
+  // Gaussian sigma of the projected angles
+  void SetDivergence(double sigma);
+
   void GeneratePrimaries(G4Event* event) override;
 
 private:
   G4ParticleGun* gun_;
 
+  EnergySpectrum spectrum_;
+  double energy_spread_;
+  int spot_type_;
+  double spot_x_, spot_y_;
+  double divergence_;
+
+  bool qnominal_;
+  double energy_;
+  G4ThreeVector position_;
+  G4ThreeVector direction_;
+
+  // as left in the gun by the last event
+  double last_energy_;
+  G4ThreeVector last_position_;
+  G4ThreeVector last_direction_;
+
+  bool HasDistributions() const;
+  void UpdateNominal();
+
 };
 
 // ==========================================================================
@@ -38,4 +75,32 @@ inline G4ParticleGun* ParticleGun::GetGun() const
   return gun_;
 }
 
+inline void ParticleGun::SetEnergySpectrum(const EnergySpectrum& spectrum)
+{
+  spectrum_ = spectrum;
+}
+
+inline void ParticleGun::SetEnergySpread(double val)
+{
+  energy_spread_ = val;
+}
+
+inline void ParticleGun::SetSpot(int type, double sx, double sy)
+{
+  spot_type_ = type;
+  spot_x_ = sx;
+  spot_y_ = sy;
+}
+
+inline void ParticleGun::SetDivergence(double sigma)
+{
+  divergence_ = sigma;
+}
+
+inline bool ParticleGun::HasDistributions() const
+{
+  return spectrum_.GetNbins() > 0 || energy_spread_ > 0. ||
+         spot_x_ > 0. || spot_y_ > 0. || divergence_ > 0.;
+}
+
 #endif
@@ -0,0 +1,129 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <chrono>
+#include <iostream>
+#include "G4Event.hh"
+#include "G4Poisson.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4Run.hh"
+#include "G4RunManager.hh"
+#include "G4Threading.hh"
+#include "Randomize.hh"
+#include "common/primaryaction.h"
+#include "common/randomengine.h"
+#include "common/simdata.h"
+
+// --------------------------------------------------------------------------
+namespace {
+
+using n_clock = std::chrono::steady_clock;
+
+} // end of namespace
+
+// ==========================================================================
+PrimaryAction::PrimaryAction(G4VUserPrimaryGeneratorAction* generator)
+  : generator_{generator}, simdata_{nullptr},
+    pileup_{1.}, qpoisson_{false}, spread_x_{0.}, spread_y_{0.},
+    qseeding_{false}, run_seed_{0},
+    captures_{nullptr}, replay_{nullptr}
+{
+}
+
+// --------------------------------------------------------------------------
+PrimaryAction::~PrimaryAction()
+{
+  delete generator_;
+}
+
+// --------------------------------------------------------------------------
+void PrimaryAction::SeedEvent(const G4Event* event) const
+{
+  auto run = G4RunManager::GetRunManager()-> GetCurrentRun();
+  long run_id = run != nullptr ? run-> GetRunID() : 0;
+
+  RandomEngine::SeedEvent(run_seed_, run_id, event-> GetEventID());
+}
+
+// --------------------------------------------------------------------------
+void PrimaryAction::RestoreEvent(const G4Event* event) const
+{
+  auto ievent = event-> GetEventID();
+  if ( ievent >= static_cast<int>(replay_-> size()) ) {
+    std::cout << "[ ERROR ] PrimaryAction::RestoreEvent() "
+                 "no captured event for event " << ievent << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  const auto& entry = (*replay_)[ievent];
+  if ( ! EventCapture::Restore(entry) ) {
+    std::exit(EXIT_FAILURE);
+  }
+  std::cout << "[ MESSAGE ] replay event " << ievent << " : captured event "
+            << entry.event_id << " (" << entry.time << " ms)" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+void PrimaryAction::GeneratePrimaries(G4Event* event)
+{
+  auto tid = G4Threading::G4GetThreadId();
+
+  if ( tid == G4Threading::MASTER_ID) {
+    tid = 0;
+  }
+
+  // allocations of primary generation and stacking belong to the event
+  simdata_[tid].BeginEventAlloc();
+
+  // before anything in this event draws random numbers
+  if ( replay_ != nullptr ) {
+    RestoreEvent(event);
+  } else if ( qseeding_ ) {
+    SeedEvent(event);
+  } else {
+    RandomEngine::ApplyLuxury();
+  }
+  if ( captures_ != nullptr ) captures_[tid].BeginEvent();
+
+  auto t0 = ::n_clock::now();
+
+  // a Poisson draw of zero is redrawn, every event has a primary
+  long noverlays = 1;
+  if ( qpoisson_ ) {
+    do {
+      noverlays = G4Poisson(pileup_);
+    } while ( noverlays == 0 );
+  } else if ( pileup_ > 1. ) {
+    noverlays = static_cast<long>(pileup_);
+  }
+
+  for ( long i = 0; i < noverlays; i++ ) {
+    auto nbegin = event-> GetNumberOfPrimaryVertex();
+    generator_-> GeneratePrimaries(event);
+
+    // all vertices of an overlay share one offset
+    if ( spread_x_ > 0. || spread_y_ > 0. ) {
+      double dx = ( G4UniformRand() - 0.5 ) * spread_x_;
+      double dy = ( G4UniformRand() - 0.5 ) * spread_y_;
+      auto nend = event-> GetNumberOfPrimaryVertex();
+      for ( auto j = nbegin; j < nend; j++ ) {
+        auto vertex = event-> GetPrimaryVertex(j);
+        auto pos = vertex-> GetPosition();
+        vertex-> SetPosition(pos.x() + dx, pos.y() + dy, pos.z());
+      }
+    }
+  }
+
+  auto t1 = ::n_clock::now();
+
+  simdata_[tid].AddPrimaryTime(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+  simdata_[tid].AddPrimaryCount(noverlays);
+}
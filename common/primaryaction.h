@@ -0,0 +1,110 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef PRIMARY_ACTION_H_
+#define PRIMARY_ACTION_H_
+
+#include <vector>
+#include "G4VUserPrimaryGeneratorAction.hh"
+#include "common/eventcapture.h"
+
+class SimData;
+
+// wrapper of a primary generator, measuring the time of generation.
+// with pile-up, the generator is called N times per event (fixed or
+// Poisson mean) and each overlay is shifted randomly in x/y. Poisson
+// draws are zero-truncated, so the mean count is n / (1 - exp(-n)).
+// with event seeding, the random engine is reseeded from (run seed,
+// run ID, event ID) before generation, independent of threads.
+// with event capture, the engine state is saved after seeding, and with
+// replay, captured states are restored in order instead of seeding.
+// otherwise, worker engines are brought to the configured luxury level.
+class PrimaryAction : public G4VUserPrimaryGeneratorAction {
+public:
+  PrimaryAction(G4VUserPrimaryGeneratorAction* generator);
+  ~PrimaryAction() override;
+
+  PrimaryAction(const PrimaryAction&) = delete;
+  void operator=(const PrimaryAction&) = delete;
+
+  void SetSimData(SimData* data);
+
+  void SetPileup(double n, bool poisson);
+  void SetPileupSpread(double dx, double dy);
+
+  void SetEventSeeding(long run_seed);
+
+  void SetEventCapture(EventCapture* captures);
+  void SetReplay(const std::vector<EventCapture::Entry>* entries);
+
+  G4VUserPrimaryGeneratorAction* GetGenerator() const;
+
+  void GeneratePrimaries(G4Event* event) override;
+
+private:
+  G4VUserPrimaryGeneratorAction* generator_;
+  SimData* simdata_;
+
+  double pileup_;
+  bool qpoisson_;
+  double spread_x_, spread_y_;
+
+  bool qseeding_;
+  long run_seed_;
+
+  EventCapture* captures_;
+  const std::vector<EventCapture::Entry>* replay_;
+
+  void SeedEvent(const G4Event* event) const;
+  void RestoreEvent(const G4Event* event) const;
+
+};
+
+// ==========================================================================
+inline void PrimaryAction::SetSimData(SimData* data)
+{
+  simdata_ = data;
+}
+
+inline void PrimaryAction::SetPileup(double n, bool poisson)
+{
+  pileup_ = n;
+  qpoisson_ = poisson;
+}
+
+inline void PrimaryAction::SetPileupSpread(double dx, double dy)
+{
+  spread_x_ = dx;
+  spread_y_ = dy;
+}
+
+inline void PrimaryAction::SetEventSeeding(long run_seed)
+{
+  qseeding_ = true;
+  run_seed_ = run_seed;
+}
+
+inline void PrimaryAction::SetEventCapture(EventCapture* captures)
+{
+  captures_ = captures;
+}
+
+inline void
+  PrimaryAction::SetReplay(const std::vector<EventCapture::Entry>* entries)
+{
+  replay_ = entries;
+}
+
+inline G4VUserPrimaryGeneratorAction* PrimaryAction::GetGenerator() const
+{
+  return generator_;
+}
+
+#endif
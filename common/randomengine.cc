@@ -0,0 +1,153 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <cstdint>
+#include <iostream>
+#include "CLHEP/Random/DualRand.h"
+#include "CLHEP/Random/JamesRandom.h"
+#include "CLHEP/Random/MTwistEngine.h"
+#include "CLHEP/Random/MixMaxRng.h"
+#include "CLHEP/Random/RanecuEngine.h"
+#include "CLHEP/Random/Ranlux64Engine.h"
+#include "CLHEP/Random/RanluxEngine.h"
+#include "CLHEP/Random/RanshiEngine.h"
+#include "G4Threading.hh"
+#include "G4Version.hh"
+#if G4VERSION_NUMBER >= 1070
+#include "CLHEP/Random/RanluxppEngine.h"
+#endif
+#include "Randomize.hh"
+#include "common/randomengine.h"
+
+// --------------------------------------------------------------------------
+namespace {
+
+std::string engine_name {""};
+int engine_luxury {-1};
+
+// --------------------------------------------------------------------------
+uint64_t splitmix64(uint64_t& state)
+{
+  uint64_t z = ( state += 0x9e3779b97f4a7c15ULL );
+  z = ( z ^ (z >> 30) ) * 0xbf58476d1ce4e5b9ULL;
+  z = ( z ^ (z >> 27) ) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+} // end of namespace
+
+// ==========================================================================
+CLHEP::HepRandomEngine* RandomEngine::Create(const std::string& name)
+{
+  if ( name == "MixMax" ) return new CLHEP::MixMaxRng();
+  if ( name == "Ranlux" || name == "Ranlux4" ) {
+    return new CLHEP::RanluxEngine(19780503L, GetLuxury(name));
+  }
+  if ( name == "Ranlux64" ) return new CLHEP::Ranlux64Engine();
+#if G4VERSION_NUMBER >= 1070
+  if ( name == "Ranluxpp" ) return new CLHEP::RanluxppEngine();
+#endif
+  if ( name == "MTwist" ) return new CLHEP::MTwistEngine();
+  if ( name == "Ranecu" ) return new CLHEP::RanecuEngine();
+  if ( name == "James" ) return new CLHEP::HepJamesRandom();
+  if ( name == "DualRand" ) return new CLHEP::DualRand();
+  if ( name == "Ranshi" ) return new CLHEP::RanshiEngine();
+
+  return nullptr;
+}
+
+// --------------------------------------------------------------------------
+std::vector<std::string> RandomEngine::GetEngineNames()
+{
+  return {
+    "MixMax", "Ranlux", "Ranlux4", "Ranlux64",
+#if G4VERSION_NUMBER >= 1070
+    "Ranluxpp",
+#endif
+    "MTwist", "Ranecu", "James", "DualRand", "Ranshi"
+  };
+}
+
+// --------------------------------------------------------------------------
+bool RandomEngine::SetEngine(const std::string& name)
+{
+  auto engine = Create(name);
+  if ( engine == nullptr ) {
+    std::cout << "[ ERROR ] RandomEngine::SetEngine() "
+                 "unknown random engine, " << name << std::endl;
+    return false;
+  }
+
+  // kept for the lifetime of the application
+  G4Random::setTheEngine(engine);
+  ::engine_name = name;
+  ::engine_luxury = GetLuxury(name);
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+const std::string& RandomEngine::GetEngineName()
+{
+  return ::engine_name;
+}
+
+// --------------------------------------------------------------------------
+int RandomEngine::GetLuxury(const std::string& name)
+{
+  // Ranlux : 3 = CLHEP default, 4 = highest, Ranlux64 : 1 = CLHEP default
+  if ( name == "Ranlux" ) return 3;
+  if ( name == "Ranlux4" ) return 4;
+  if ( name == "Ranlux64" ) return 1;
+  return -1;
+}
+
+// --------------------------------------------------------------------------
+int RandomEngine::GetLuxury()
+{
+  return ::engine_luxury;
+}
+
+// --------------------------------------------------------------------------
+void RandomEngine::ApplyLuxury()
+{
+  // the master (and serial runs) are seeded with the level already
+  if ( ::engine_luxury < 0 || G4Threading::IsMasterThread() ) return;
+
+  // still a function of the seeds given by G4 for this event
+  auto engine = G4Random::getTheEngine();
+  long seeds[3];
+  seeds[0] = static_cast<long>(engine-> flat() * 2147483647.) + 1;
+  seeds[1] = static_cast<long>(engine-> flat() * 2147483647.) + 1;
+  seeds[2] = 0;
+  G4Random::setTheSeeds(seeds, ::engine_luxury);
+}
+
+// --------------------------------------------------------------------------
+void RandomEngine::MakeEventSeeds(long run_seed, long run_id, long event_id,
+                                  long seeds[3])
+{
+  uint64_t state = run_seed;
+  state = ::splitmix64(state) ^ static_cast<uint64_t>(run_id);
+  state = ::splitmix64(state) ^ static_cast<uint64_t>(event_id);
+
+  // positive 31-bit seeds, accepted by all engines
+  seeds[0] = static_cast<long>(::splitmix64(state) >> 33) + 1;
+  seeds[1] = static_cast<long>(::splitmix64(state) >> 33) + 1;
+  seeds[2] = 0;
+}
+
+// --------------------------------------------------------------------------
+void RandomEngine::SeedEvent(long run_seed, long run_id, long event_id)
+{
+  long seeds[3];
+  MakeEventSeeds(run_seed, run_id, event_id, seeds);
+  G4Random::setTheSeeds(seeds, ::engine_luxury);
+}
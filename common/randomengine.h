@@ -0,0 +1,59 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef RANDOM_ENGINE_H_
+#define RANDOM_ENGINE_H_
+
+#include <string>
+#include <vector>
+
+namespace CLHEP {
+class HepRandomEngine;
+}
+
+// selection of CLHEP random engines by name.
+// the luxury level of the selected engine is kept for reseeding, since
+// CLHEP seeding calls reset Ranlux engines to the level passed with them
+class RandomEngine {
+public:
+  RandomEngine() = default;
+  ~RandomEngine() = default;
+
+  // nullptr for an unknown name
+  static CLHEP::HepRandomEngine* Create(const std::string& name);
+
+  static std::vector<std::string> GetEngineNames();
+
+  // set as the (master) engine, before creating run managers so that
+  // worker engines are of the same type
+  static bool SetEngine(const std::string& name);
+
+  // name given to SetEngine(), empty if never set
+  static const std::string& GetEngineName();
+
+  // luxury level of an engine, -1 for engines without levels
+  static int GetLuxury(const std::string& name);
+  // ... of the engine set by SetEngine()
+  static int GetLuxury();
+
+  // worker threads: G4 reseeds worker engines per event at their default
+  // level, so the engine is reseeded from itself at the configured one
+  static void ApplyLuxury();
+
+  // positive 31-bit seeds of an event from (run seed, run ID, event ID),
+  // independent of threads, and the current engine seeded with them at
+  // the configured luxury level
+  static void MakeEventSeeds(long run_seed, long run_id, long event_id,
+                             long seeds[3]);
+  static void SeedEvent(long run_seed, long run_id, long event_id);
+
+};
+
+#endif
@@ -0,0 +1,151 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <chrono>
+#include "G4Navigator.hh"
+#include "G4Threading.hh"
+#include "G4TransportationManager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "Randomize.hh"
+#include "common/rayshooter.h"
+#include "common/simdata.h"
+
+// --------------------------------------------------------------------------
+namespace {
+
+using n_clock = std::chrono::steady_clock;
+
+// safety net against rays stuck on a boundary
+constexpr long kMaxStepsPerRay = 100000;
+
+// navigator calls are timed in every n-th ray
+constexpr long kCallSampling = 100;
+
+// --------------------------------------------------------------------------
+inline double ElapsedNanoSec(const n_clock::time_point& t0,
+                             const n_clock::time_point& t1)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>
+         (t1 - t0).count();
+}
+
+} // end of namespace
+
+// ==========================================================================
+RayShooter::RayShooter()
+  : simdata_{nullptr}, navigator_{nullptr},
+    origin_{}, direction_{0., 0., 1.},
+    spread_x_{0.}, spread_y_{0.}, rays_per_event_{100}, nrays_{0}
+{
+}
+
+// --------------------------------------------------------------------------
+RayShooter::~RayShooter()
+{
+  delete navigator_;
+}
+
+// --------------------------------------------------------------------------
+void RayShooter::GeneratePrimaries(G4Event*)
+{
+  // own navigator, so that tracking state is never disturbed
+  if ( navigator_ == nullptr ) {
+    auto tracking_navigator = G4TransportationManager::
+      GetTransportationManager()-> GetNavigatorForTracking();
+    navigator_ = new G4Navigator();
+    navigator_-> SetWorldVolume(tracking_navigator-> GetWorldVolume());
+  }
+
+  auto tid = G4Threading::G4GetThreadId();
+
+  if ( tid == G4Threading::MASTER_ID) {
+    tid = 0;
+  }
+
+  auto& data = simdata_[tid];
+  data.BeginEventAlloc();
+
+  for ( int i = 0; i < rays_per_event_; i++ ) {
+    auto dx = spread_x_ * ( G4UniformRand() - 0.5 );
+    auto dy = spread_y_ * ( G4UniformRand() - 0.5 );
+    auto pos0 = origin_ + G4ThreeVector(dx, dy, 0.);
+
+    long nsteps = 0;
+    if ( nrays_ % ::kCallSampling == 0 ) {
+      nsteps = ShootTimedRay(pos0, data);
+    } else {
+      auto t0 = ::n_clock::now();
+      nsteps = ShootRay(pos0);
+      auto t1 = ::n_clock::now();
+      data.AddRayTime(::ElapsedNanoSec(t0, t1), nsteps);
+    }
+    data.AddRay(nsteps);
+    nrays_++;
+  }
+}
+
+// --------------------------------------------------------------------------
+long RayShooter::ShootRay(const G4ThreeVector& pos0)
+{
+  auto pos = pos0;
+  const auto& dir = direction_;
+
+  auto volume = navigator_-> LocateGlobalPointAndSetup(pos, &dir,
+                                                       false, false);
+  long nsteps = 0;
+  while ( volume != nullptr && nsteps < ::kMaxStepsPerRay ) {
+    double safety = 0.;
+    auto step = navigator_-> ComputeStep(pos, dir, kInfinity, safety);
+    nsteps++;
+
+    if ( step == kInfinity ) break;
+
+    pos += step * dir;
+    navigator_-> SetGeometricallyLimitedStep();
+    volume = navigator_-> LocateGlobalPointAndSetup(pos, &dir, true, false);
+  }
+
+  return nsteps;
+}
+
+// --------------------------------------------------------------------------
+long RayShooter::ShootTimedRay(const G4ThreeVector& pos0, SimData& data)
+{
+  auto pos = pos0;
+  const auto& dir = direction_;
+
+  auto t0 = ::n_clock::now();
+  auto volume = navigator_-> LocateGlobalPointAndSetup(pos, &dir,
+                                                       false, false);
+  auto t1 = ::n_clock::now();
+  data.AddLocateTime(::ElapsedNanoSec(t0, t1));
+
+  long nsteps = 0;
+  while ( volume != nullptr && nsteps < ::kMaxStepsPerRay ) {
+    double safety = 0.;
+    t0 = ::n_clock::now();
+    auto step = navigator_-> ComputeStep(pos, dir, kInfinity, safety);
+    t1 = ::n_clock::now();
+    data.AddComputeStepTime(::ElapsedNanoSec(t0, t1));
+    nsteps++;
+
+    if ( step == kInfinity ) break;
+
+    pos += step * dir;
+    navigator_-> SetGeometricallyLimitedStep();
+
+    t0 = ::n_clock::now();
+    volume = navigator_-> LocateGlobalPointAndSetup(pos, &dir, true, false);
+    t1 = ::n_clock::now();
+    data.AddLocateTime(::ElapsedNanoSec(t0, t1));
+  }
+
+  return nsteps;
+}
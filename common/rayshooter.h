@@ -0,0 +1,84 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef RAY_SHOOTER_H_
+#define RAY_SHOOTER_H_
+
+#include "G4ThreeVector.hh"
+#include "G4VUserPrimaryGeneratorAction.hh"
+
+class G4Navigator;
+class SimData;
+
+// navigation-only benchmark : traces straight rays through the geometry
+// with a raw G4Navigator instead of generating primaries.
+// rays are timed as a whole, and single navigator calls are timed only
+// in every n-th ray (clock overhead is not in the step time)
+class RayShooter : public G4VUserPrimaryGeneratorAction {
+public:
+  RayShooter();
+  ~RayShooter() override;
+
+  RayShooter(const RayShooter&) = delete;
+  void operator=(const RayShooter&) = delete;
+
+  void SetSimData(SimData* data);
+
+  void SetOrigin(const G4ThreeVector& pos);
+  void SetDirection(const G4ThreeVector& dir);
+  void SetSpread(double dx, double dy);
+  void SetRaysPerEvent(int n);
+
+  void GeneratePrimaries(G4Event* event) override;
+
+private:
+  SimData* simdata_;
+  G4Navigator* navigator_;
+
+  G4ThreeVector origin_;
+  G4ThreeVector direction_;
+  double spread_x_;
+  double spread_y_;
+  int rays_per_event_;
+  long nrays_;
+
+  long ShootRay(const G4ThreeVector& pos0);
+  long ShootTimedRay(const G4ThreeVector& pos0, SimData& data);
+
+};
+
+// ==========================================================================
+inline void RayShooter::SetSimData(SimData* data)
+{
+  simdata_ = data;
+}
+
+inline void RayShooter::SetOrigin(const G4ThreeVector& pos)
+{
+  origin_ = pos;
+}
+
+inline void RayShooter::SetDirection(const G4ThreeVector& dir)
+{
+  direction_ = dir.unit();
+}
+
+inline void RayShooter::SetSpread(double dx, double dy)
+{
+  spread_x_ = dx;
+  spread_y_ = dy;
+}
+
+inline void RayShooter::SetRaysPerEvent(int n)
+{
+  rays_per_event_ = n;
+}
+
+#endif
@@ -8,15 +8,35 @@ This software is distributed WITHOUT ANY WARRANTY; without even the
 implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
 See the License for more information.
 ============================================================================*/
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
 #include <fstream>
+#include <set>
+#include <vector>
 #include "G4AutoLock.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
 #include "G4Run.hh"
+#include "G4SmartVoxelHeader.hh"
+#include "G4SmartVoxelNode.hh"
+#include "G4SmartVoxelProxy.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4Threading.hh"
 #include "G4Version.hh"
+#include "common/eventcapture.h"
+#include "common/eventdigest.h"
+#include "common/eventreader.h"
 #include "common/runaction.h"
 #include "common/simdata.h"
+#include "common/steptable.h"
+#include "util/benchreport.h"
+#include "util/memhook.h"
+#include "util/procstat.h"
+#include "util/profiler.h"
 #include "util/timehistory.h"
+#include "util/tracer.h"
 
 using namespace kut;
 
@@ -24,8 +44,46 @@ using namespace kut;
 namespace {
 
 TimeHistory* gtimer = nullptr;
+BenchReport* report = nullptr;
+Tracer* tracer = nullptr;
 G4Mutex cout_mutex  = G4MUTEX_INITIALIZER;
 
+// --------------------------------------------------------------------------
+// bytes of a smart voxel header, equal slices share one proxy
+std::size_t GetVoxelSize(const G4SmartVoxelHeader* header,
+                         std::set<const G4SmartVoxelProxy*>& proxies)
+{
+  auto nslices = header-> GetNoSlices();
+  std::size_t size = sizeof(G4SmartVoxelHeader) +
+                     nslices * sizeof(G4SmartVoxelProxy*);
+  for ( std::size_t i = 0; i < nslices; i++ ) {
+    auto proxy = header-> GetSlice(i);
+    if ( ! proxies.insert(proxy).second ) continue;
+
+    size += sizeof(G4SmartVoxelProxy);
+    if ( proxy-> IsHeader() ) {
+      size += ::GetVoxelSize(proxy-> GetHeader(), proxies);
+    } else {
+      size += sizeof(G4SmartVoxelNode) +
+              proxy-> GetNode()-> GetNoContained() * sizeof(G4int);
+    }
+  }
+  return size;
+}
+
+// --------------------------------------------------------------------------
+// smart voxels of all logical volumes, built when geometry is closed
+std::size_t GetGeometryVoxelSize()
+{
+  std::set<const G4SmartVoxelProxy*> proxies;
+  std::size_t size = 0;
+  for ( auto lv : *G4LogicalVolumeStore::GetInstance() ) {
+    auto header = lv-> GetVoxelHeader();
+    if ( header != nullptr ) size += ::GetVoxelSize(header, proxies);
+  }
+  return size;
+}
+
 // --------------------------------------------------------------------------
 void ShowWorkerRunSummary(const G4Run* run)
 {
@@ -44,15 +102,79 @@ void ShowWorkerRunSummary(const G4Run* run)
   l.unlock();
 }
 
+// --------------------------------------------------------------------------
+struct Distribution {
+  int n {0};
+  double min {0.}, mean {0.}, median {0.}, p90 {0.}, max {0.};
+};
+
+// --------------------------------------------------------------------------
+Distribution MakeDistribution(std::vector<double> vals)
+{
+  Distribution dist;
+  dist.n = vals.size();
+  if ( dist.n == 0 ) return dist;
+
+  std::sort(vals.begin(), vals.end());
+  double sum = 0.;
+  for ( auto val : vals ) sum += val;
+
+  // nearest-rank percentile
+  auto percentile = [&vals](double p) {
+    int idx = static_cast<int>(std::ceil(p * vals.size())) - 1;
+    return vals[std::max(idx, 0)];
+  };
+
+  dist.min = vals.front();
+  dist.mean = sum / dist.n;
+  dist.median = percentile(0.5);
+  dist.p90 = percentile(0.9);
+  dist.max = vals.back();
+
+  return dist;
+}
+
+// --------------------------------------------------------------------------
+void ShowDistribution(const std::string& title, const Distribution& dist)
+{
+  std::cout << " - " << title << " = "
+            << dist.min << " / " << dist.mean << " / " << dist.median
+            << " / " << dist.p90 << " / " << dist.max << " sec" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+void WriteDistribution(std::ofstream& ofs, const std::string& key,
+                       const Distribution& dist)
+{
+  ofs << "    \"" << key << "\" : { "
+      << "\"min\" : " << dist.min << ", "
+      << "\"mean\" : " << dist.mean << ", "
+      << "\"median\" : " << dist.median << ", "
+      << "\"p90\" : " << dist.p90 << ", "
+      << "\"max\" : " << dist.max << " }";
+}
+
 } // end of namespace
 
 // ==========================================================================
 RunAction::RunAction()
   : simdata_{nullptr}, nvec_{0},
     total_step_count_{0}, total_edep_{0.},
-    bench_name_{"bench"}, cpu_name_{"cpu"}
+    total_ray_count_{0}, total_nav_step_count_{0},
+    total_ray_time_{0.}, total_timed_step_count_{0},
+    total_compute_step_time_{0.}, total_compute_step_count_{0},
+    total_locate_time_{0.},
+    total_locate_count_{0}, total_primary_time_{0.},
+    total_primary_count_{0},
+    bench_name_{"bench"}, cpu_name_{"cpu"}, run_mode_{"physics"},
+    event_reader_{nullptr}, digests_{nullptr},
+    captures_{nullptr}, capture_threshold_{0.}, capture_percentile_{0.},
+    step_tables_{nullptr}, init_alloc_count_{0}, init_alloc_bytes_{0},
+    rss_begin_{0}
 {
   ::gtimer = TimeHistory::GetTimeHistory();
+  ::report = BenchReport::GetBenchReport();
+  ::tracer = Tracer::GetTracer();
 }
 
 // --------------------------------------------------------------------------
@@ -61,16 +183,48 @@ void RunAction::BeginOfRunAction(const G4Run*)
   if (IsMaster()) {
     for ( int i = 0; i < nvec_; i++) {
       simdata_[i].Initialize();
+      if ( digests_ != nullptr ) digests_[i].Clear();
+      if ( captures_ != nullptr ) captures_[i].Clear();
+      if ( step_tables_ != nullptr ) step_tables_[i].Clear();
+    }
+
+    // master thread allocations (the only thread in serial is below)
+    if ( G4Threading::IsMultithreadedApplication() ) {
+      auto count = MemHook::GetThreadCount();
+      init_alloc_count_ = count.nallocs;
+      init_alloc_bytes_ = count.bytes;
     }
+    rss_begin_ = ProcStat::GetResidentSize();
+
+    // geometry is closed at run initialization
+    ::report-> SetLong("geometry/voxel_kb", ::GetGeometryVoxelSize() / 1024);
 
     std::cout << std::endl;
     ::gtimer-> TakeSplit("RunBegin");
   }
+
+  ::tracer-> Begin("run");
+
+  // per-thread run start (workers in MT, the only thread in serial)
+  if ( ! IsMaster() || ! G4Threading::IsMultithreadedApplication() ) {
+    auto tid = G4Threading::G4GetThreadId();
+
+    if ( tid == G4Threading::MASTER_ID) {
+      tid = 0;
+    }
+
+    simdata_[tid].SetRunStartTime(::gtimer-> GetElapsed());
+
+    auto count = MemHook::GetThreadCount();
+    simdata_[tid].SetRunStartAlloc(count.nallocs, count.bytes);
+  }
 }
 
 // --------------------------------------------------------------------------
 void RunAction::EndOfRunAction(const G4Run* run)
 {
+  ::tracer-> End();
+
   if (IsMaster()) {
     ::gtimer-> TakeSplit("RunEnd");
     ReduceResult();
@@ -85,10 +239,143 @@ void RunAction::ReduceResult()
 {
   total_step_count_ = 0;
   total_edep_ = 0.;
+  total_ray_count_ = 0;
+  total_nav_step_count_ = 0;
+  total_ray_time_ = 0.;
+  total_timed_step_count_ = 0;
+  total_compute_step_time_ = 0.;
+  total_compute_step_count_ = 0;
+  total_locate_time_ = 0.;
+  total_locate_count_ = 0;
+  total_primary_time_ = 0.;
+  total_primary_count_ = 0;
 
+  long long edep_quanta = 0;
   for (int i = 0; i < nvec_; i++ ) {
     total_step_count_ += simdata_[i].GetStepCount();
-    total_edep_ += simdata_[i].GetEdep();
+    edep_quanta += simdata_[i].GetEdepQuanta();
+    total_ray_count_ += simdata_[i].GetRayCount();
+    total_nav_step_count_ += simdata_[i].GetNavStepCount();
+    total_ray_time_ += simdata_[i].GetRayTime();
+    total_timed_step_count_ += simdata_[i].GetTimedStepCount();
+    total_compute_step_time_ += simdata_[i].GetComputeStepTime();
+    total_compute_step_count_ += simdata_[i].GetComputeStepCount();
+    total_locate_time_ += simdata_[i].GetLocateTime();
+    total_locate_count_ += simdata_[i].GetLocateCount();
+    total_primary_time_ += simdata_[i].GetPrimaryTime();
+    total_primary_count_ += simdata_[i].GetPrimaryCount();
+  }
+  total_edep_ = edep_quanta * SimData::kEdepQuantum;
+
+  // stacking (with a stacking action)
+  long ntracks = 0, urgent_depth_sum = 0, max_urgent = 0, max_waiting = 0;
+  long nwaiting = 0, nkilled = 0, nstages = 0;
+  for (int i = 0; i < nvec_; i++ ) {
+    ntracks += simdata_[i].GetTrackCount();
+    urgent_depth_sum += simdata_[i].GetUrgentDepthSum();
+    max_urgent = std::max(max_urgent, simdata_[i].GetMaxUrgentDepth());
+    max_waiting = std::max(max_waiting, simdata_[i].GetMaxWaitingDepth());
+    nwaiting += simdata_[i].GetWaitingTrackCount();
+    nkilled += simdata_[i].GetKilledTrackCount();
+    nstages += simdata_[i].GetStackStageCount();
+  }
+  if ( ntracks > 0 ) {
+    ::report-> SetLong("stack/tracks", ntracks);
+    ::report-> SetLong("stack/waiting", nwaiting);
+    ::report-> SetLong("stack/killed", nkilled);
+    ::report-> SetLong("stack/stages", nstages);
+    ::report-> SetDouble("stack/mean_urgent", double(urgent_depth_sum) /
+                                              ntracks);
+    ::report-> SetLong("stack/max_urgent", max_urgent);
+    ::report-> SetLong("stack/max_waiting", max_waiting);
+  }
+
+  // memory, allocations before run start of each thread count for init
+  if ( MemHook::IsEnabled() ) {
+    long init_allocs = init_alloc_count_, init_bytes = init_alloc_bytes_;
+    long event_allocs = 0, event_bytes = 0, event_peak = 0, nevents = 0;
+    for (int i = 0; i < nvec_; i++ ) {
+      init_allocs += simdata_[i].GetRunStartAllocCount();
+      init_bytes += simdata_[i].GetRunStartAllocBytes();
+      event_allocs += simdata_[i].GetEventAllocCount();
+      event_bytes += simdata_[i].GetEventAllocBytes();
+      event_peak = std::max(event_peak, simdata_[i].GetMaxEventAllocPeak());
+      nevents += simdata_[i].GetAllocEventCount();
+    }
+    auto total = MemHook::GetTotalCount();
+    const double kB = 1024., MB = 1024. * 1024.;
+    nevents = std::max(nevents, 1L);
+    ::report-> SetLong("memory/threads", MemHook::GetNthreads());
+    ::report-> SetLong("memory/init_allocs", init_allocs);
+    ::report-> SetDouble("memory/init_mb", init_bytes / MB);
+    ::report-> SetLong("memory/loop_allocs", total.nallocs - init_allocs);
+    ::report-> SetDouble("memory/loop_mb", (total.bytes - init_bytes) / MB);
+    ::report-> SetDouble("memory/allocs_per_event",
+                         double(event_allocs) / nevents);
+    ::report-> SetDouble("memory/kb_per_event", event_bytes / kB / nevents);
+    ::report-> SetDouble("memory/max_event_peak_kb", event_peak / kB);
+    ::report-> SetDouble("memory/live_mb", total.live / MB);
+  }
+
+  auto rss_end = ProcStat::GetResidentSize();
+  if ( rss_end > 0 ) {
+    ::report-> SetLong("memory/rss_begin_kb", rss_begin_);
+    ::report-> SetLong("memory/rss_end_kb", rss_end);
+    ::report-> SetLong("memory/rss_peak_kb", ProcStat::GetPeakResidentSize());
+  }
+
+  if ( event_reader_ != nullptr ) event_reader_-> Report();
+
+  if ( step_tables_ != nullptr ) StepTable::Report(step_tables_, nvec_);
+
+  if ( digests_ != nullptr ) {
+    int64_t nevents = 0;
+    auto fingerprint = EventDigest::Merge(digests_, nvec_,
+                                          digest_file_, nevents);
+    char hex[20];
+    std::snprintf(hex, sizeof(hex), "%016" PRIx64, fingerprint);
+    ::report-> SetString("digest/fingerprint", hex);
+    ::report-> SetLong("digest/events", nevents);
+    if ( digest_file_ != "" ) {
+      ::report-> SetString("digest/file", digest_file_);
+    }
+  }
+
+  if ( captures_ != nullptr ) {
+    double cut = 0.;
+    int nslow = EventCapture::Write(captures_, nvec_, capture_file_,
+                                    capture_threshold_, capture_percentile_,
+                                    cut);
+    ::report-> SetString("slow/file", capture_file_);
+    ::report-> SetDouble("slow/cut_ms", cut);
+    ::report-> SetLong("slow/events", nslow);
+  }
+
+  if ( profile_file_ != "" ) {
+    auto profiler = Profiler::GetProfiler();
+    profiler-> WriteFolded(profile_file_);
+    double overhead = profiler-> GetOverhead();
+    double cpu_time = profiler-> GetProcessTime();
+    ::report-> SetString("profiler/file", profile_file_);
+    ::report-> SetLong("profiler/frequency", profiler-> GetFrequency());
+    ::report-> SetString("profiler/unwind",
+                         profiler-> GetUnwind() == Profiler::kFramePointer ?
+                         "fp" : "backtrace");
+    ::report-> SetLong("profiler/threads", profiler-> GetNthreads());
+    ::report-> SetLong("profiler/samples", profiler-> GetNsamples());
+    ::report-> SetLong("profiler/dropped", profiler-> GetNdropped());
+    ::report-> SetDouble("profiler/overhead_sec", overhead);
+    ::report-> SetDouble("profiler/overhead_share",
+                         cpu_time > 0. ? overhead / cpu_time : 0.);
+  }
+
+  if ( trace_file_ != "" ) {
+    ::tracer-> WriteJson(trace_file_);
+    ::report-> SetString("trace/file", trace_file_);
+    ::report-> SetLong("trace/sampling", ::tracer-> GetSampling());
+    ::report-> SetLong("trace/threads", ::tracer-> GetNthreads());
+    ::report-> SetLong("trace/spans", ::tracer-> GetNspans());
+    ::report-> SetLong("trace/dropped", ::tracer-> GetNdropped());
   }
 }
 
@@ -125,6 +412,49 @@ void RunAction::ShowRunSummary(const G4Run* run) const
   // steps/msec
   double sps = total_step_count_ / proc_time * msec;
 
+  // navigation benchmark (ray shooting)
+  bool qnav = total_ray_count_ > 0;
+  double nav_sps = 0., ns_per_step = 0.;
+  double ns_per_compute_step = 0., ns_per_locate = 0.;
+  if ( qnav ) {
+    nav_sps = total_nav_step_count_ / proc_time * msec;
+    ns_per_step = total_ray_time_ / std::max(total_timed_step_count_, 1L);
+    ns_per_compute_step = total_compute_step_time_ /
+                          std::max(total_compute_step_count_, 1L);
+    ns_per_locate = total_locate_time_ / std::max(total_locate_count_, 1L);
+  }
+
+  // primary generation, share of event processing time of all threads
+  if ( total_primary_time_ > 0. ) {
+    double primary_us = total_primary_time_ / nevents * 1.e-3;
+    double share = total_primary_time_ * 1.e-9 /
+                   ( proc_time * std::max(nvec_, 1) );
+    ::report-> SetDouble("primary/time_per_event_us", primary_us);
+    ::report-> SetDouble("primary/share", share);
+    ::report-> SetDouble("primary/overlays_per_event",
+                         double(total_primary_count_) / nevents);
+  }
+
+  // per-worker initialization (relative to BeamOn for run latencies)
+  std::vector<double> vec_setup, vec_ready, vec_first;
+  for ( int i = 0; i < nvec_; i++ ) {
+    const auto& data = simdata_[i];
+    if ( data.GetThreadStartTime() >= 0. &&
+         data.GetWorkerStartTime() >= 0. ) {
+      vec_setup.push_back(data.GetWorkerStartTime() -
+                          data.GetThreadStartTime());
+    }
+    if ( data.GetRunStartTime() >= 0. ) {
+      vec_ready.push_back(data.GetRunStartTime() - t_start);
+    }
+    if ( data.GetFirstEventTime() >= 0. ) {
+      vec_first.push_back(data.GetFirstEventTime() - t_start);
+    }
+  }
+  auto dist_setup = ::MakeDistribution(vec_setup);
+  auto dist_ready = ::MakeDistribution(vec_ready);
+  auto dist_first = ::MakeDistribution(vec_first);
+
   std::cout << std::endl;
   std::cout << "=============================================================="
             << std::endl;
@@ -133,6 +463,7 @@ void RunAction::ShowRunSummary(const G4Run* run) const
             << nevents_to_be << std::endl
             << " - elapsed cpu time = " << elapsed_time << " sec" << std::endl
             << " - initialization time = " << init_time << " sec" << std::endl
+            << " - run mode = " << run_mode_ << std::endl
             << " *** Physics regression ***" << std::endl
             << " - edep in cal per event = " << edep_cal << " MeV/event"
             << std::endl
@@ -145,6 +476,31 @@ void RunAction::ShowRunSummary(const G4Run* run) const
             <<" *** SPS Score ***" << std::endl
             << " - steps per msec = " << sps << " steps/msec"
             << std::endl;
+  if ( qnav ) {
+    std::cout << " *** Navigation Score ***" << std::endl
+              << " - # rays = " << total_ray_count_ << std::endl
+              << " - navigation steps per msec = " << nav_sps
+              << " steps/msec" << std::endl
+              << " - time per navigation step = " << ns_per_step
+              << " nsec" << std::endl
+              << " - time per ComputeStep (sampled) = " << ns_per_compute_step
+              << " nsec" << std::endl
+              << " - time per LocateGlobalPointAndSetup (sampled) = "
+              << ns_per_locate << " nsec" << std::endl;
+  }
+  if ( ::report-> HasItems() ) {
+    std::cout << " *** Benchmark Report ***" << std::endl;
+    ::report-> ShowItems();
+  }
+  if ( dist_first.n > 0 ) {
+    std::cout << " *** Worker Initialization (min/mean/median/p90/max) ***"
+              << std::endl;
+    if ( dist_setup.n > 0 ) {
+      ::ShowDistribution("thread setup", dist_setup);
+    }
+    ::ShowDistribution("run ready after BeamOn", dist_ready);
+    ::ShowDistribution("first event after BeamOn", dist_first);
+  }
   std::cout << "=============================================================="
             << std::endl << std::endl;
 
@@ -169,13 +525,38 @@ void RunAction::ShowRunSummary(const G4Run* run) const
              << "  \"cpu\" : \"" << cpu_name_ << "\"," << std::endl
              << "  \"g4version\" : " << g4version << "," << std::endl
              << "  \"thread\" : " << nthreads_ << "," << std::endl
+             << "  \"mode\" : \"" << run_mode_ << "\"," << std::endl
              << "  \"event\"  : " << nevents << "," << std::endl
              << "  \"time\" : " << elapsed_time << "," << std::endl
              << "  \"init\" : " << init_time << "," << std::endl
              << "  \"tpe\" : " << average_time_per_event << "," << std::endl
              << "  \"eps\" : " << proc_eps << "," << std::endl
-             << "  \"sps\" : " << sps << "," << std::endl
-             << "  \"edep\" : " << edep_cal << std::endl
+             << "  \"sps\" : " << sps << "," << std::endl;
+    if ( qnav ) {
+      jsonfile << "  \"navigation\" : {" << std::endl
+               << "    \"rays\" : " << total_ray_count_ << "," << std::endl
+               << "    \"steps\" : " << total_nav_step_count_ << ","
+               << std::endl
+               << "    \"sps\" : " << nav_sps << "," << std::endl
+               << "    \"step_ns\" : " << ns_per_step << "," << std::endl
+               << "    \"compute_step_ns\" : " << ns_per_compute_step << ","
+               << std::endl
+               << "    \"locate_ns\" : " << ns_per_locate << std::endl
+               << "  }," << std::endl;
+    }
+    if ( dist_first.n > 0 ) {
+      jsonfile << "  \"worker\" : {" << std::endl;
+      if ( dist_setup.n > 0 ) {
+        ::WriteDistribution(jsonfile, "setup", dist_setup);
+        jsonfile << "," << std::endl;
+      }
+      ::WriteDistribution(jsonfile, "ready", dist_ready);
+      jsonfile << "," << std::endl;
+      ::WriteDistribution(jsonfile, "first_event", dist_first);
+      jsonfile << std::endl << "  }," << std::endl;
+    }
+    ::report-> WriteJson(jsonfile);
+    jsonfile << "  \"edep\" : " << edep_cal << std::endl
              << "}" << std::endl;
     jsonfile.close();
   }
@@ -14,7 +14,11 @@ See the License for more information.
 #include <string>
 #include "G4UserRunAction.hh"
 
+class EventCapture;
+class EventDigest;
+class EventReader;
 class SimData;
+class StepTable;
 
 class RunAction : public G4UserRunAction {
 public:
@@ -28,13 +32,33 @@ public:
   void BeginOfRunAction(const G4Run* run) override;
   void EndOfRunAction(const G4Run* run) override;
 
-  void ReduceResult();
+  virtual void ReduceResult();
 
   void ShowRunSummary(const G4Run* run) const;
 
   void SetBenchName(const std::string& name);
   void SetCPUName(const std::string& name);
   void SetNThreads(int nt);
+  void SetRunMode(const std::string& mode);
+
+  // input event reader reporting its statistics (master)
+  void SetEventReader(const EventReader* reader);
+
+  // per-event digests of all threads, merged into a run fingerprint
+  void SetEventDigest(EventDigest* digests, const std::string& fname);
+
+  // slow events over max(threshold (ms), percentile cut) are saved
+  void SetEventCapture(EventCapture* captures, const std::string& fname,
+                       double threshold, double percentile);
+
+  // folded stacks of the sampling profiler
+  void SetProfileFile(const std::string& fname);
+
+  // Chrome trace of the timelines of all threads
+  void SetTraceFile(const std::string& fname);
+
+  // step accounting of all threads
+  void SetStepTable(StepTable* tables);
 
 private:
   SimData* simdata_;
@@ -44,9 +68,42 @@ private:
   long total_step_count_;
   double total_edep_;
 
+  long total_ray_count_;
+  long total_nav_step_count_;
+  double total_ray_time_;
+  long total_timed_step_count_;
+  double total_compute_step_time_;
+  long total_compute_step_count_;
+  double total_locate_time_;
+  long total_locate_count_;
+
+  double total_primary_time_;
+  long total_primary_count_;
+
   std::string bench_name_;
   std::string cpu_name_;
   int nthreads_;
+  std::string run_mode_;
+
+  const EventReader* event_reader_;
+
+  EventDigest* digests_;
+  std::string digest_file_;
+
+  EventCapture* captures_;
+  std::string capture_file_;
+  double capture_threshold_;
+  double capture_percentile_;
+
+  std::string profile_file_;
+  std::string trace_file_;
+
+  StepTable* step_tables_;
+
+  // master allocations and RSS (kB) at run start
+  long init_alloc_count_;
+  long init_alloc_bytes_;
+  long rss_begin_;
 };
 
 // ==========================================================================
@@ -80,4 +137,46 @@ inline void RunAction::SetNThreads(int nt)
   nthreads_ = nt;
 }
 
+inline void RunAction::SetRunMode(const std::string& mode)
+{
+  run_mode_ = mode;
+}
+
+inline void RunAction::SetEventReader(const EventReader* reader)
+{
+  event_reader_ = reader;
+}
+
+inline void RunAction::SetEventDigest(EventDigest* digests,
+                                      const std::string& fname)
+{
+  digests_ = digests;
+  digest_file_ = fname;
+}
+
+inline void RunAction::SetEventCapture(EventCapture* captures,
+                                       const std::string& fname,
+                                       double threshold, double percentile)
+{
+  captures_ = captures;
+  capture_file_ = fname;
+  capture_threshold_ = threshold;
+  capture_percentile_ = percentile;
+}
+
+inline void RunAction::SetProfileFile(const std::string& fname)
+{
+  profile_file_ = fname;
+}
+
+inline void RunAction::SetTraceFile(const std::string& fname)
+{
+  trace_file_ = fname;
+}
+
+inline void RunAction::SetStepTable(StepTable* tables)
+{
+  step_tables_ = tables;
+}
+
 #endif
@@ -11,6 +11,8 @@ See the License for more information.
 #ifndef SIM_DATA_H_
 #define SIM_DATA_H_
 
+#include "util/memhook.h"
+
 class SimData {
 public:
   SimData() = default;
@@ -24,12 +26,122 @@ public:
   void AddStepCount();
   long GetStepCount() const;
 
+  void AddTrackCount();
+  long GetTrackCount() const;
+
+  // stacking, depths of stacks sampled at each new track
+  void AddStackDepth(long nurgent, long nwaiting);
+  long GetUrgentDepthSum() const;
+  long GetMaxUrgentDepth() const;
+  long GetMaxWaitingDepth() const;
+
+  void AddWaitingTrack();
+  long GetWaitingTrackCount() const;
+
+  void AddKilledTrack();
+  long GetKilledTrackCount() const;
+
+  void AddStackStage();
+  long GetStackStageCount() const;
+
+  // edep is accumulated in fixed point, so that totals are exact and
+  // independent of the order of steps, events and threads
+  static constexpr double kEdepQuantum = 1.e-6;  // 1 eV in G4 units (MeV)
+
   void AddEdep(double val);
   double GetEdep() const;
+  long long GetEdepQuanta() const;
+
+  // navigation benchmark (ray shooting, time in nsec)
+  void AddRay(long nsteps);
+  long GetRayCount() const;
+  long GetNavStepCount() const;
+
+  // rays timed as a whole
+  void AddRayTime(double t, long nsteps);
+  double GetRayTime() const;
+  long GetTimedStepCount() const;
+
+  // single calls, timed in sampled rays
+  void AddComputeStepTime(double t);
+  double GetComputeStepTime() const;
+  long GetComputeStepCount() const;
+
+  void AddLocateTime(double t);
+  double GetLocateTime() const;
+  long GetLocateCount() const;
+
+  // primary generation (time in nsec)
+  void AddPrimaryTime(double t);
+  double GetPrimaryTime() const;
+
+  void AddPrimaryCount(long n);
+  long GetPrimaryCount() const;
+
+  // allocations counted by the memory hook (bytes), cumulative counts
+  // of the thread at its run start and deltas within events
+  void SetRunStartAlloc(long nallocs, long bytes);
+  long GetRunStartAllocCount() const;
+  long GetRunStartAllocBytes() const;
+
+  // event window, from primary generation to end of event action
+  void BeginEventAlloc();
+  void EndEventAlloc();
+  long GetEventAllocCount() const;
+  long GetEventAllocBytes() const;
+  long GetMaxEventAllocPeak() const;
+  long GetAllocEventCount() const;
+
+  // worker timeline (sec, measured by TimeHistory)
+  void SetThreadStartTime(double t);
+  double GetThreadStartTime() const;
+
+  void SetWorkerStartTime(double t);
+  double GetWorkerStartTime() const;
+
+  void SetRunStartTime(double t);
+  double GetRunStartTime() const;
+
+  void SetFirstEventTime(double t);
+  double GetFirstEventTime() const;
 
 private:
   long step_count_;
-  double edep_;
+  long track_count_;
+  long long edep_;
+
+  long urgent_depth_sum_;
+  long max_urgent_depth_;
+  long max_waiting_depth_;
+  long waiting_track_count_;
+  long killed_track_count_;
+  long stack_stage_count_;
+
+  long ray_count_;
+  long nav_step_count_;
+  double ray_time_;
+  long timed_step_count_;
+  double compute_step_time_;
+  long compute_step_count_;
+  double locate_time_;
+  long locate_count_;
+
+  double primary_time_;
+  long primary_count_;
+
+  long run_start_alloc_count_;
+  long run_start_alloc_bytes_;
+  long event_alloc_count_;
+  long event_alloc_bytes_;
+  long max_event_alloc_peak_;
+  long alloc_event_count_;
+  kut::MemCount event_start_alloc_;
+
+  // negative for not recorded, thread/worker start are kept over runs
+  double thread_start_time_ {-1.};
+  double worker_start_time_ {-1.};
+  double run_start_time_ {-1.};
+  double first_event_time_ {-1.};
 
 };
 
@@ -44,20 +156,290 @@ inline long SimData::GetStepCount() const
   return step_count_;
 }
 
+inline void SimData::AddTrackCount()
+{
+  track_count_++;
+}
+
+inline long SimData::GetTrackCount() const
+{
+  return track_count_;
+}
+
+inline void SimData::AddStackDepth(long nurgent, long nwaiting)
+{
+  urgent_depth_sum_ += nurgent;
+  if ( nurgent > max_urgent_depth_ ) max_urgent_depth_ = nurgent;
+  if ( nwaiting > max_waiting_depth_ ) max_waiting_depth_ = nwaiting;
+}
+
+inline long SimData::GetUrgentDepthSum() const
+{
+  return urgent_depth_sum_;
+}
+
+inline long SimData::GetMaxUrgentDepth() const
+{
+  return max_urgent_depth_;
+}
+
+inline long SimData::GetMaxWaitingDepth() const
+{
+  return max_waiting_depth_;
+}
+
+inline void SimData::AddWaitingTrack()
+{
+  waiting_track_count_++;
+}
+
+inline long SimData::GetWaitingTrackCount() const
+{
+  return waiting_track_count_;
+}
+
+inline void SimData::AddKilledTrack()
+{
+  killed_track_count_++;
+}
+
+inline long SimData::GetKilledTrackCount() const
+{
+  return killed_track_count_;
+}
+
+inline void SimData::AddStackStage()
+{
+  stack_stage_count_++;
+}
+
+inline long SimData::GetStackStageCount() const
+{
+  return stack_stage_count_;
+}
+
 inline void SimData::AddEdep(double val)
 {
-  edep_ += val;
+  edep_ += static_cast<long long>(val / kEdepQuantum + 0.5);
 }
 
 inline double SimData::GetEdep() const
+{
+  return edep_ * kEdepQuantum;
+}
+
+inline long long SimData::GetEdepQuanta() const
 {
   return edep_;
 }
 
+inline void SimData::AddRay(long nsteps)
+{
+  ray_count_++;
+  nav_step_count_ += nsteps;
+}
+
+inline long SimData::GetRayCount() const
+{
+  return ray_count_;
+}
+
+inline long SimData::GetNavStepCount() const
+{
+  return nav_step_count_;
+}
+
+inline void SimData::AddRayTime(double t, long nsteps)
+{
+  ray_time_ += t;
+  timed_step_count_ += nsteps;
+}
+
+inline double SimData::GetRayTime() const
+{
+  return ray_time_;
+}
+
+inline long SimData::GetTimedStepCount() const
+{
+  return timed_step_count_;
+}
+
+inline void SimData::AddComputeStepTime(double t)
+{
+  compute_step_time_ += t;
+  compute_step_count_++;
+}
+
+inline double SimData::GetComputeStepTime() const
+{
+  return compute_step_time_;
+}
+
+inline long SimData::GetComputeStepCount() const
+{
+  return compute_step_count_;
+}
+
+inline void SimData::AddLocateTime(double t)
+{
+  locate_time_ += t;
+  locate_count_++;
+}
+
+inline double SimData::GetLocateTime() const
+{
+  return locate_time_;
+}
+
+inline long SimData::GetLocateCount() const
+{
+  return locate_count_;
+}
+
+inline void SimData::AddPrimaryTime(double t)
+{
+  primary_time_ += t;
+}
+
+inline double SimData::GetPrimaryTime() const
+{
+  return primary_time_;
+}
+
+inline void SimData::AddPrimaryCount(long n)
+{
+  primary_count_ += n;
+}
+
+inline long SimData::GetPrimaryCount() const
+{
+  return primary_count_;
+}
+
+inline void SimData::SetThreadStartTime(double t)
+{
+  thread_start_time_ = t;
+}
+
+inline double SimData::GetThreadStartTime() const
+{
+  return thread_start_time_;
+}
+
+inline void SimData::SetWorkerStartTime(double t)
+{
+  worker_start_time_ = t;
+}
+
+inline double SimData::GetWorkerStartTime() const
+{
+  return worker_start_time_;
+}
+
+inline void SimData::SetRunStartTime(double t)
+{
+  run_start_time_ = t;
+}
+
+inline double SimData::GetRunStartTime() const
+{
+  return run_start_time_;
+}
+
+inline void SimData::SetFirstEventTime(double t)
+{
+  first_event_time_ = t;
+}
+
+inline double SimData::GetFirstEventTime() const
+{
+  return first_event_time_;
+}
+
+inline void SimData::SetRunStartAlloc(long nallocs, long bytes)
+{
+  run_start_alloc_count_ = nallocs;
+  run_start_alloc_bytes_ = bytes;
+}
+
+inline long SimData::GetRunStartAllocCount() const
+{
+  return run_start_alloc_count_;
+}
+
+inline long SimData::GetRunStartAllocBytes() const
+{
+  return run_start_alloc_bytes_;
+}
+
+inline void SimData::BeginEventAlloc()
+{
+  if ( ! kut::MemHook::IsEnabled() ) return;
+  event_start_alloc_ = kut::MemHook::GetThreadCount();
+  kut::MemHook::ResetPeak();
+}
+
+inline void SimData::EndEventAlloc()
+{
+  if ( ! kut::MemHook::IsEnabled() ) return;
+  auto count = kut::MemHook::GetThreadCount();
+  event_alloc_count_ += count.nallocs - event_start_alloc_.nallocs;
+  event_alloc_bytes_ += count.bytes - event_start_alloc_.bytes;
+  auto peak = count.peak - event_start_alloc_.live;
+  if ( peak > max_event_alloc_peak_ ) max_event_alloc_peak_ = peak;
+  alloc_event_count_++;
+}
+
+inline long SimData::GetEventAllocCount() const
+{
+  return event_alloc_count_;
+}
+
+inline long SimData::GetEventAllocBytes() const
+{
+  return event_alloc_bytes_;
+}
+
+inline long SimData::GetMaxEventAllocPeak() const
+{
+  return max_event_alloc_peak_;
+}
+
+inline long SimData::GetAllocEventCount() const
+{
+  return alloc_event_count_;
+}
+
 inline void SimData::Initialize()
 {
   step_count_ = 0;
-  edep_ = 0.;
+  track_count_ = 0;
+  urgent_depth_sum_ = 0;
+  max_urgent_depth_ = 0;
+  max_waiting_depth_ = 0;
+  waiting_track_count_ = 0;
+  killed_track_count_ = 0;
+  stack_stage_count_ = 0;
+  edep_ = 0;
+  ray_count_ = 0;
+  nav_step_count_ = 0;
+  ray_time_ = 0.;
+  timed_step_count_ = 0;
+  compute_step_time_ = 0.;
+  compute_step_count_ = 0;
+  locate_time_ = 0.;
+  locate_count_ = 0;
+  primary_time_ = 0.;
+  primary_count_ = 0;
+  run_start_alloc_count_ = 0;
+  run_start_alloc_bytes_ = 0;
+  event_alloc_count_ = 0;
+  event_alloc_bytes_ = 0;
+  max_event_alloc_peak_ = 0;
+  alloc_event_count_ = 0;
+  run_start_time_ = -1.;
+  first_event_time_ = -1.;
 }
 
 #endif
@@ -0,0 +1,77 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <algorithm>
+#include "G4Neutron.hh"
+#include "G4StackManager.hh"
+#include "G4Threading.hh"
+#include "G4Track.hh"
+#include "common/simdata.h"
+#include "common/stackaction.h"
+
+// --------------------------------------------------------------------------
+StackAction::StackAction()
+  : simdata_{nullptr}, waiting_energy_{0.},
+    neutron_kill_energy_{0.}, kill_time_{0.}
+{
+}
+
+// --------------------------------------------------------------------------
+SimData& StackAction::GetThreadData() const
+{
+  auto tid = G4Threading::G4GetThreadId();
+
+  if ( tid == G4Threading::MASTER_ID) {
+    tid = 0;
+  }
+
+  return simdata_[tid];
+}
+
+// --------------------------------------------------------------------------
+G4ClassificationOfNewTrack StackAction::ClassifyNewTrack(const G4Track* track)
+{
+  auto& data = GetThreadData();
+
+  data.AddTrackCount();
+  data.AddStackDepth(stackManager-> GetNUrgentTrack(),
+                     stackManager-> GetNWaitingTrack());
+
+  // kill policies
+  auto pdef = track-> GetDefinition();
+  if ( neutron_kill_energy_ > 0. && pdef == G4Neutron::Definition() &&
+       track-> GetKineticEnergy() < neutron_kill_energy_ ) {
+    data.AddKilledTrack();
+    return fKill;
+  }
+  if ( kill_time_ > 0. && track-> GetGlobalTime() > kill_time_ ) {
+    data.AddKilledTrack();
+    return fKill;
+  }
+
+  // deferred to the waiting stack
+  bool qwaiting =
+    ( waiting_energy_ > 0. && track-> GetKineticEnergy() < waiting_energy_ ) ||
+    std::find(waiting_particles_.begin(), waiting_particles_.end(), pdef) !=
+    waiting_particles_.end();
+  if ( qwaiting ) {
+    data.AddWaitingTrack();
+    return fWaiting;
+  }
+
+  return fUrgent;
+}
+
+// --------------------------------------------------------------------------
+void StackAction::NewStage()
+{
+  // urgent stack is empty, waiting tracks are moved to it
+  GetThreadData().AddStackStage();
+}
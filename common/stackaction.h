@@ -0,0 +1,80 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef STACK_ACTION_H_
+#define STACK_ACTION_H_
+
+#include <vector>
+#include "G4UserStackingAction.hh"
+
+class G4ParticleDefinition;
+class SimData;
+
+// stacking action counting tracks and stack depths. by default all tracks
+// are urgent (LIFO). tracks of given particles or below an energy can be
+// deferred to the waiting stack, processed after the urgent stack is
+// empty. low-energy neutrons and late tracks can be killed.
+class StackAction : public G4UserStackingAction {
+public:
+  StackAction();
+  ~StackAction() override = default;
+
+  void SetSimData(SimData* data);
+
+  void AddWaitingParticle(const G4ParticleDefinition* pdef);
+  void SetWaitingEnergy(double e);
+
+  void SetNeutronKillEnergy(double e);
+  void SetKillTime(double t);  // global time at creation
+
+  G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track) override;
+
+  void NewStage() override;
+
+private:
+  SimData* simdata_;
+
+  std::vector<const G4ParticleDefinition*> waiting_particles_;
+  double waiting_energy_;
+
+  double neutron_kill_energy_;
+  double kill_time_;
+
+  SimData& GetThreadData() const;
+
+};
+
+// ==========================================================================
+inline void StackAction::SetSimData(SimData* data)
+{
+  simdata_ = data;
+}
+
+inline void StackAction::AddWaitingParticle(const G4ParticleDefinition* pdef)
+{
+  waiting_particles_.push_back(pdef);
+}
+
+inline void StackAction::SetWaitingEnergy(double e)
+{
+  waiting_energy_ = e;
+}
+
+inline void StackAction::SetNeutronKillEnergy(double e)
+{
+  neutron_kill_energy_ = e;
+}
+
+inline void StackAction::SetKillTime(double t)
+{
+  kill_time_ = t;
+}
+
+#endif
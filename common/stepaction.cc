@@ -12,10 +12,11 @@ See the License for more information.
 #include "G4Threading.hh"
 #include "common/simdata.h"
 #include "common/stepaction.h"
+#include "common/steptable.h"
 
 // --------------------------------------------------------------------------
 StepAction::StepAction()
-  : simdata_{nullptr}
+  : simdata_{nullptr}, tables_{nullptr}
 {
 }
 
@@ -29,4 +30,6 @@ void StepAction::UserSteppingAction(const G4Step* step)
   }
 
   simdata_[tid].AddStepCount();
+
+  if ( tables_ != nullptr ) tables_[tid].Fill(step);
 }
@@ -14,6 +14,7 @@ See the License for more information.
 #include "G4UserSteppingAction.hh"
 
 class SimData;
+class StepTable;
 
 class StepAction : public G4UserSteppingAction {
 public:
@@ -21,11 +22,13 @@ public:
   ~StepAction() override = default;
 
   void SetSimData(SimData* data);
+  void SetStepTable(StepTable* tables);
 
   void UserSteppingAction(const G4Step* step) override;
 
 private:
   SimData* simdata_;
+  StepTable* tables_;
 
 };
 
@@ -35,4 +38,9 @@ inline void StepAction::SetSimData(SimData* data)
   simdata_ = data;
 }
 
+inline void StepAction::SetStepTable(StepTable* tables)
+{
+  tables_ = tables;
+}
+
 #endif
@@ -0,0 +1,232 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Step.hh"
+#include "G4VProcess.hh"
+#include "common/steptable.h"
+#include "util/benchreport.h"
+
+// --------------------------------------------------------------------------
+namespace {
+
+// sub-types of processes, the last slot for larger ones
+constexpr int kProcessSlots = 1024;
+
+struct Row {
+  std::string name;
+  long steps;
+  double time;  // ns
+};
+
+// --------------------------------------------------------------------------
+void ShowRows(const std::string& title, std::vector<Row>& rows,
+              long total_steps, double total_time)
+{
+  std::sort(rows.begin(), rows.end(),
+            [](const Row& a, const Row& b) { return a.steps > b.steps; });
+
+  std::cout << " - " << title << " (steps / share / time share)"
+            << std::endl;
+  for ( const auto& row : rows ) {
+    std::cout << "   " << std::setw(24) << std::left << row.name
+              << std::right << std::setw(14) << row.steps
+              << std::fixed << std::setprecision(1)
+              << std::setw(7) << 100. * row.steps / total_steps << " %";
+    if ( total_time > 0. ) {
+      std::cout << std::setw(7) << 100. * row.time / total_time << " %";
+    }
+    std::cout << std::defaultfloat << std::setprecision(6) << std::endl;
+  }
+}
+
+// --------------------------------------------------------------------------
+std::string ToJson(const std::vector<Row>& rows)
+{
+  std::stringstream ss;
+  ss << "{ ";
+  for ( std::size_t i = 0; i < rows.size(); i++ ) {
+    if ( i > 0 ) ss << ", ";
+    ss << "\"" << rows[i].name << "\" : { \"steps\" : " << rows[i].steps
+       << ", \"time\" : " << rows[i].time * 1.e-9 << " }";
+  }
+  ss << " }";
+  return ss.str();
+}
+
+} // end of namespace
+
+// ==========================================================================
+StepTable::StepTable()
+  : sampling_{0}, counter_{0}, qtimed_{false},
+    processes_(::kProcessSlots)
+{
+}
+
+// --------------------------------------------------------------------------
+void StepTable::Clear()
+{
+  counter_ = 0;
+  qtimed_ = false;
+
+  // volumes are known once geometry is built
+  volumes_.assign(G4LogicalVolumeStore::GetInstance()-> size(), Entry());
+  for ( auto& entry : particles_ ) entry = Entry();
+  for ( auto& entry : processes_ ) {
+    entry.steps = 0;
+    entry.time = 0.;
+  }
+}
+
+// --------------------------------------------------------------------------
+void StepTable::AddProcessName(ProcessEntry& entry,
+                               const G4VProcess* process)
+{
+  // processes of a sub-type have one slot (eIoni, hIoni, ...)
+  entry.last = process;
+  const auto& name = process-> GetProcessName();
+  if ( std::find(entry.names.begin(), entry.names.end(), name) ==
+       entry.names.end() ) {
+    entry.names.push_back(name);
+  }
+}
+
+// --------------------------------------------------------------------------
+void StepTable::Fill(const G4Step* step)
+{
+  // sampled time, from the previous step to this step
+  double time = 0.;
+  if ( sampling_ > 0 ) {
+    if ( qtimed_ ) {
+      time = std::chrono::duration<double, std::nano>
+             (n_clock::now() - t0_).count() * sampling_;
+      qtimed_ = false;
+    }
+    if ( ++counter_ >= sampling_ ) {
+      counter_ = 0;
+      qtimed_ = true;
+      t0_ = n_clock::now();
+    }
+  }
+
+  auto lv = step-> GetPreStepPoint()-> GetPhysicalVolume()->
+            GetLogicalVolume();
+  auto ilv = lv-> GetInstanceID();
+  if ( ilv >= static_cast<int>(volumes_.size()) ) volumes_.resize(ilv + 1);
+  volumes_[ilv].steps++;
+  volumes_[ilv].time += time;
+
+  auto pdef = step-> GetTrack()-> GetDefinition();
+  auto ipart = pdef-> GetInstanceID();
+  if ( ipart >= 0 ) {
+    if ( ipart >= static_cast<int>(particles_.size()) ) {
+      particles_.resize(ipart + 1);
+      particle_defs_.resize(ipart + 1, nullptr);
+    }
+    particle_defs_[ipart] = pdef;
+    particles_[ipart].steps++;
+    particles_[ipart].time += time;
+  }
+
+  auto process = step-> GetPostStepPoint()-> GetProcessDefinedStep();
+  if ( process != nullptr ) {
+    auto iproc = std::min(std::max(process-> GetProcessSubType(), 0),
+                          ::kProcessSlots - 1);
+    auto& entry = processes_[iproc];
+    if ( entry.last != process ) AddProcessName(entry, process);
+    entry.steps++;
+    entry.time += time;
+  }
+}
+
+// --------------------------------------------------------------------------
+void StepTable::Report(const StepTable* tables, int ntables)
+{
+  // volumes and particles are shared by threads, processes are not
+  std::vector<Row> volumes, particles, processes;
+
+  auto lv_store = G4LogicalVolumeStore::GetInstance();
+  for ( auto lv : *lv_store ) {
+    Row row { lv-> GetName(), 0, 0. };
+    for ( int i = 0; i < ntables; i++ ) {
+      const auto& vec = tables[i].volumes_;
+      auto ilv = lv-> GetInstanceID();
+      if ( ilv < static_cast<int>(vec.size()) ) {
+        row.steps += vec[ilv].steps;
+        row.time += vec[ilv].time;
+      }
+    }
+    if ( row.steps > 0 ) volumes.push_back(row);
+  }
+
+  for ( int i = 0; i < ntables; i++ ) {
+    const auto& table = tables[i];
+    for ( std::size_t j = 0; j < table.particles_.size(); j++ ) {
+      if ( table.particles_[j].steps == 0 ) continue;
+      if ( particles.size() <= j ) particles.resize(j + 1, Row{"", 0, 0.});
+      particles[j].name = table.particle_defs_[j]-> GetParticleName();
+      particles[j].steps += table.particles_[j].steps;
+      particles[j].time += table.particles_[j].time;
+    }
+  }
+  particles.erase(std::remove_if(particles.begin(), particles.end(),
+                                 [](const Row& r) { return r.steps == 0; }),
+                  particles.end());
+
+  for ( int iproc = 0; iproc < ::kProcessSlots; iproc++ ) {
+    Row row { "", 0, 0. };
+    std::vector<std::string> names;
+    for ( int i = 0; i < ntables; i++ ) {
+      const auto& entry = tables[i].processes_[iproc];
+      row.steps += entry.steps;
+      row.time += entry.time;
+      for ( const auto& name : entry.names ) {
+        if ( std::find(names.begin(), names.end(), name) == names.end() ) {
+          names.push_back(name);
+        }
+      }
+    }
+    if ( row.steps == 0 ) continue;
+    for ( std::size_t j = 0; j < names.size(); j++ ) {
+      row.name += ( j > 0 ? "/" : "" ) + names[j];
+    }
+    processes.push_back(row);
+  }
+
+  long total_steps = 0;
+  double total_time = 0.;
+  for ( const auto& row : volumes ) {
+    total_steps += row.steps;
+    total_time += row.time;
+  }
+  if ( total_steps == 0 ) return;
+
+  std::cout << std::endl;
+  std::cout << "=============================================================="
+            << std::endl;
+  std::cout << " Step Accounting" << std::endl;
+  ::ShowRows("volume", volumes, total_steps, total_time);
+  ::ShowRows("particle", particles, total_steps, total_time);
+  ::ShowRows("process", processes, total_steps, total_time);
+  std::cout << "=============================================================="
+            << std::endl;
+
+  auto report = kut::BenchReport::GetBenchReport();
+  report-> SetRaw("steps/volumes", ::ToJson(volumes));
+  report-> SetRaw("steps/particles", ::ToJson(particles));
+  report-> SetRaw("steps/processes", ::ToJson(processes));
+  report-> SetDouble("steps/sampled_time", total_time * 1.e-9);
+}
@@ -0,0 +1,77 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef STEP_TABLE_H_
+#define STEP_TABLE_H_
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+class G4ParticleDefinition;
+class G4Step;
+class G4VProcess;
+
+// step accounting of one thread (one per thread), by logical volume,
+// particle and step-limiting process. tables are dense, indexed by
+// instance IDs of volumes / particles and by process sub-types.
+// the time of every n-th step is sampled.
+class alignas(64) StepTable {
+public:
+  StepTable();
+  ~StepTable() = default;
+
+  StepTable(const StepTable&) = delete;
+  StepTable& operator=(const StepTable&) = delete;
+
+  // every n-th step is timed, 0 for no timing
+  void SetSampling(int n);
+
+  void Clear();
+
+  void Fill(const G4Step* step);
+
+  // summed over threads, shown and added to the bench report
+  static void Report(const StepTable* tables, int ntables);
+
+private:
+  struct Entry {
+    long steps {0};
+    double time {0.};  // ns, sampled
+  };
+
+  struct ProcessEntry : Entry {
+    const G4VProcess* last {nullptr};
+    std::vector<std::string> names;
+  };
+
+  using n_clock = std::chrono::steady_clock;
+
+  int sampling_;
+  int counter_;
+  bool qtimed_;
+  n_clock::time_point t0_;
+
+  std::vector<Entry> volumes_;
+  std::vector<Entry> particles_;
+  std::vector<const G4ParticleDefinition*> particle_defs_;
+  std::vector<ProcessEntry> processes_;
+
+  void AddProcessName(ProcessEntry& entry, const G4VProcess* process);
+
+};
+
+// ==========================================================================
+inline void StepTable::SetSampling(int n)
+{
+  sampling_ = n;
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <string>
+#include "G4Threading.hh"
+#include "common/simdata.h"
+#include "common/workerinit.h"
+#include "util/mempolicy.h"
+#include "util/profiler.h"
+#include "util/timehistory.h"
+#include "util/tracer.h"
+
+using namespace kut;
+
+// --------------------------------------------------------------------------
+namespace {
+
+TimeHistory* gtimer = nullptr;
+
+} // end of namespace
+
+// ==========================================================================
+WorkerInit::WorkerInit()
+  : simdata_{nullptr}
+{
+  ::gtimer = TimeHistory::GetTimeHistory();
+}
+
+// --------------------------------------------------------------------------
+void WorkerInit::WorkerInitialize() const
+{
+  auto tid = G4Threading::G4GetThreadId();
+
+  if ( tid == G4Threading::MASTER_ID) {
+    tid = 0;
+  }
+
+  if ( simdata_[tid].GetThreadStartTime() < 0. ) {
+    simdata_[tid].SetThreadStartTime(::gtimer-> GetElapsed());
+  }
+
+  // local allocation, unless workers share the policy of the master
+  MemPolicy::GetMemPolicy()-> ApplyThread();
+
+  auto tracer = Tracer::GetTracer();
+  tracer-> SetThreadName("worker " + std::to_string(tid));
+  tracer-> Begin("setup");
+}
+
+// --------------------------------------------------------------------------
+void WorkerInit::WorkerStart() const
+{
+  auto tid = G4Threading::G4GetThreadId();
+
+  if ( tid == G4Threading::MASTER_ID) {
+    tid = 0;
+  }
+
+  if ( simdata_[tid].GetWorkerStartTime() < 0. ) {
+    simdata_[tid].SetWorkerStartTime(::gtimer-> GetElapsed());
+  }
+
+  Tracer::GetTracer()-> End();
+
+  // sampling of this thread, if the profiler is active
+  Profiler::GetProfiler()-> RegisterThread();
+}
+
+// --------------------------------------------------------------------------
+void WorkerInit::WorkerStop() const
+{
+  Profiler::GetProfiler()-> UnregisterThread();
+}
@@ -0,0 +1,45 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef WORKER_INIT_H_
+#define WORKER_INIT_H_
+
+#include "G4UserWorkerInitialization.hh"
+
+class SimData;
+
+class WorkerInit : public G4UserWorkerInitialization {
+public:
+  WorkerInit();
+  ~WorkerInit() override = default;
+
+  void SetSimData(SimData* data);
+
+  // thread is created (before worker run manager)
+  void WorkerInitialize() const override;
+
+  // worker kernel and user actions are instantiated
+  void WorkerStart() const override;
+
+  // thread is terminated
+  void WorkerStop() const override;
+
+private:
+  SimData* simdata_;
+
+};
+
+// ==========================================================================
+inline void WorkerInit::SetSimData(SimData* data)
+{
+  simdata_ = data;
+}
+
+#endif
@@ -17,6 +17,9 @@ set(GEANT4_INSTALL /opt/geant4/11.3.0
 # visualization flag
 set(ENABLE_VIS FALSE CACHE BOOL "Enable visualization flag")
 
+# memory accounting (replaces global operator new/delete)
+set(ENABLE_MEMHOOK FALSE CACHE BOOL "Enable allocation counting flag")
+
 # Optimizaton / Debug flags
 set(OPTIMIZE TRUE CACHE BOOL "Optimizaton flag (O3)")
 set(DEBUG FALSE CACHE BOOL "Debug mode")
@@ -10,18 +10,26 @@ See the License for more information.
 ============================================================================*/
 #include <vector>
 #include "FTFP_BERT.hh"
+#include "G4Geantino.hh"
 #include "G4ParticleGun.hh"
 #include "G4ParticleTable.hh"
 #include "G4RunManager.hh"
 #include "G4SystemOfUnits.hh"
 #include "ecalgeom.h"
 #include "common/appbuilder.h"
+#include "common/appsetup.h"
 #include "common/eventaction.h"
+#include "common/eventsource.h"
 #include "common/particlegun.h"
+#include "common/primaryaction.h"
+#include "common/rayshooter.h"
 #include "common/runaction.h"
 #include "common/simdata.h"
 #include "common/stepaction.h"
+#include "common/workerinit.h"
+#include "util/benchreport.h"
 #include "util/jsonparser.h"
+#include "util/tracer.h"
 
 using namespace kut;
 
@@ -30,12 +38,35 @@ namespace {
 
 G4RunManager* run_manager {nullptr};
 JsonParser* jparser {nullptr};
+AppSetup* appsetup {nullptr};
 
 // --------------------------------------------------------------------------
 void SetupGeomtry(SimData* data)
 {
   auto geom = new EcalGeom();
   geom-> SetSimData(data);
+
+  if ( ::jparser-> Contains("Geometry/layout") ) {
+    auto layout = ::jparser-> GetStringValue("Geometry/layout");
+    if ( layout == "placement" ) {
+      geom-> SetLayout(EcalGeom::kPlacement);
+    } else if ( layout == "replica" ) {
+      geom-> SetLayout(EcalGeom::kReplica);
+    } else if ( layout == "parameterised" ) {
+      geom-> SetLayout(EcalGeom::kParameterised);
+    } else if ( layout == "division" ) {
+      geom-> SetLayout(EcalGeom::kDivision);
+    } else {
+      std::cout << "[ ERROR ] SetupGeomtry() "
+                   "invalid geometry layout, " << layout << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if ( ::jparser-> Contains("Geometry/voxel_mother") ) {
+    geom-> SetVoxelMother(::jparser-> GetBoolValue("Geometry/voxel_mother"));
+  }
+
   ::run_manager-> SetUserInitialization(geom);
 }
 
@@ -60,6 +91,9 @@ void SetupParticleGun(ParticleGun* pga)
   auto pname = ::jparser-> GetStringValue("Primary/particle");
   auto ptable = G4ParticleTable::GetParticleTable();
   auto pdef = ptable-> FindParticle(pname);
+  if ( ::appsetup-> GetRunMode() == "geantino" ) {
+    pdef = G4Geantino::Geantino();
+  }
   if ( pdef != nullptr ) {
     gun-> SetParticleDefinition(pdef);
   }
@@ -77,6 +111,45 @@ void SetupParticleGun(ParticleGun* pga)
 
   auto pos = GetPrimaryPosition();
   gun-> SetParticlePosition(pos);
+
+  ::appsetup-> ConfigureParticleGun(pga);
+}
+
+// --------------------------------------------------------------------------
+G4VUserPrimaryGeneratorAction* SetupEventSource()
+{
+  auto source = new EventSource();
+  source-> SetEventReader(::appsetup-> GetEventReader());
+  source-> SetPosition(GetPrimaryPosition());
+
+  return source;
+}
+
+// --------------------------------------------------------------------------
+G4VUserPrimaryGeneratorAction* SetupRayShooter(SimData* data)
+{
+  auto shooter = new RayShooter();
+  shooter-> SetSimData(data);
+  shooter-> SetOrigin(GetPrimaryPosition());
+
+  std::vector<double> dvec;
+  if ( ::jparser-> Contains("Primary/direction") ) {
+    dvec.clear();
+    ::jparser-> GetDoubleArray("Primary/direction", dvec);
+    shooter-> SetDirection(G4ThreeVector(dvec[0], dvec[1], dvec[2]));
+  }
+
+  if ( ::jparser-> Contains("Navigation/rays") ) {
+    shooter-> SetRaysPerEvent(::jparser-> GetIntValue("Navigation/rays"));
+  }
+
+  if ( ::jparser-> Contains("Navigation/spread") ) {
+    dvec.clear();
+    ::jparser-> GetDoubleArray("Navigation/spread", dvec);
+    shooter-> SetSpread(dvec[0]*cm, dvec[1]*cm);
+  }
+
+  return shooter;
 }
 
 } // end of namespace
@@ -87,6 +160,7 @@ AppBuilder::AppBuilder()
     bench_name_{""}, cpu_name_{""}
 {
   ::jparser = JsonParser::GetJsonParser();
+  ::appsetup = AppSetup::GetAppSetup();
 }
 
 // --------------------------------------------------------------------------
@@ -100,30 +174,58 @@ void AppBuilder::BuildApplication(int nthreads)
 {
   ::run_manager = G4RunManager::GetRunManager();
 
+  ::appsetup-> SetupRunMode();
+
+  ::appsetup-> SetupSeeding();
+
   nvec_ = nthreads;
 
   simdata_ = new SimData[nvec_];
+  ::appsetup-> SetupEventDigest(nvec_);
+  ::appsetup-> SetupEventCapture(nvec_);
+  ::appsetup-> SetupStepTable(nvec_);
+  ::appsetup-> StartProfiler();
+  ::appsetup-> StartTracer();
+  Tracer::GetTracer()-> Begin("initialize");
 
   ::SetupGeomtry(simdata_);
+  ::appsetup-> LoadEnergySpectrum();
+  ::appsetup-> StartEventReader();
   ::run_manager-> SetUserInitialization(new FTFP_BERT);
   ::run_manager-> SetUserInitialization(this);
 
-  long seed { 0L };
-  if ( jparser-> Contains("Run/Seed") ) {
-    seed = jparser-> GetLongValue("Run/Seed");
+  if ( ::run_manager-> GetRunManagerType() != G4RunManager::sequentialRM ) {
+    auto worker_init = new WorkerInit();
+    worker_init-> SetSimData(simdata_);
+    ::run_manager-> SetUserInitialization(worker_init);
   }
 
-  G4Random::setTheSeed(seed);
+  ::appsetup-> SeedRandomEngine();
 
   ::run_manager-> Initialize();
+
+  Tracer::GetTracer()-> End();
 }
 
 // --------------------------------------------------------------------------
 void AppBuilder::Build() const
 {
-  auto pga = new ParticleGun();
-  ::SetupParticleGun(pga);
-  SetUserAction(pga);
+  if ( ::appsetup-> GetRunMode() == "navigator" ) {
+    SetUserAction(::SetupRayShooter(simdata_));
+  } else {
+    G4VUserPrimaryGeneratorAction* pga {nullptr};
+    if ( ::appsetup-> GetEventReader() != nullptr ) {
+      pga = ::SetupEventSource();
+    } else {
+      auto gun = new ParticleGun();
+      ::SetupParticleGun(gun);
+      pga = gun;
+    }
+    auto primary_action = new PrimaryAction(pga);
+    primary_action-> SetSimData(simdata_);
+    ::appsetup-> ConfigurePrimaryAction(primary_action);
+    SetUserAction(primary_action);
+  }
 
   auto runaction = new RunAction();
   runaction-> SetSimData(simdata_);
@@ -132,12 +234,20 @@ void AppBuilder::Build() const
   runaction-> SetBenchName(bench_name_);
   runaction-> SetCPUName(cpu_name_);
   runaction-> SetNThreads(nvec_);
+  ::appsetup-> ConfigureRunAction(runaction);
   SetUserAction(runaction);
 
-  SetUserAction(new EventAction);
+  auto eventaction = new EventAction();
+  eventaction-> SetSimData(simdata_);
+  ::appsetup-> ConfigureEventAction(eventaction);
+  SetUserAction(eventaction);
+
+  auto stackaction = ::appsetup-> CreateStackAction(simdata_);
+  if ( stackaction != nullptr ) SetUserAction(stackaction);
 
   auto stepaction = new StepAction;
   stepaction-> SetSimData(simdata_);
+  ::appsetup-> ConfigureStepAction(stepaction);
   SetUserAction(stepaction);
 }
 
@@ -151,6 +261,7 @@ void AppBuilder::BuildForMaster() const
   runaction-> SetBenchName(bench_name_);
   runaction-> SetCPUName(cpu_name_);
   runaction-> SetNThreads(nvec_);
+  ::appsetup-> ConfigureRunAction(runaction);
 
   SetUserAction(runaction);
 }
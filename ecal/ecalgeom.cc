@@ -10,104 +10,289 @@ See the License for more information.
 ============================================================================*/
 #include "G4Box.hh"
 #include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
 #include "G4NistManager.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4PVDivision.hh"
+#include "G4PVParameterised.hh"
 #include "G4PVPlacement.hh"
+#include "G4PVReplica.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4Tubs.hh"
 #include "G4VisAttributes.hh"
 #include "ecalgeom.h"
+#include "grid_pvp.h"
 #include "common/calscorer.h"
+#include "util/benchreport.h"
+#include "util/procstat.h"
+
+using namespace kut;
+
+// --------------------------------------------------------------------------
+namespace {
+
+// tracker : 5 layers x 23 air voxels, each holding an Al tube
+const double kDXZ_Voxel = 20.*mm;
+const double kDL_Voxel = 60.*cm;
+const int kNzTracker = 5;
+const int kNxTracker = 23;
+const double kZTracker = -20.*cm;  // center of the 1st layer
+const double kTubeInner = 8.5*mm;
+const double kTubeOuter = 9.5*mm;
+
+// calorimeter : 23 x 23 CsI crystals
+const double kDXY_Cal = 25.*mm;
+const double kDZ_Cal = 30.*cm;
+const int kNxyCal = 23;
+const double kZ_Cal = 20.*cm;
+
+const char* kLayoutName[] = {
+  "placement", "replica", "parameterised", "division"
+};
+
+} // end of namespace
 
 // --------------------------------------------------------------------------
 G4VPhysicalVolume* EcalGeom::Construct()
 {
+  // materials first, the same for every layout
   auto nist_manager = G4NistManager::Instance();
+  auto air = nist_manager-> FindOrBuildMaterial("G4_AIR");
+  nist_manager-> FindOrBuildMaterial("G4_Al");
+  nist_manager-> FindOrBuildMaterial("G4_CESIUM_IODIDE");
+
+  auto rss0 = ProcStat::GetResidentSize();
 
   // world volume
   const double kDXYZ_World = 100.*cm;
   auto world_box = new G4Box("world", kDXYZ_World/2.,
                                       kDXYZ_World/2., kDXYZ_World/2.);
 
-  auto air = nist_manager-> FindOrBuildMaterial("G4_AIR");
   auto world_lv = new G4LogicalVolume(world_box, air, "world");
 
   auto world_pv = new G4PVPlacement(nullptr, G4ThreeVector(), "world",
                                     world_lv, nullptr, false, 0);
 
-  // voxel
-  const double kDXZ_Voxel = 20.*mm;
-  const double kDL_Voxel = 60.*cm;
+  ConstructTracker(world_lv);
+  ConstructCalorimeter(world_lv);
 
-  auto voxel_box = new G4Box("voxel", kDXZ_Voxel/2., kDL_Voxel/2.,
-                                      kDXZ_Voxel/2.);
-  auto voxel_lv = new G4LogicalVolume(voxel_box, air, "voxel");
+  // vis attributes
+  auto va = new G4VisAttributes(G4Color(1.,1.,1.));
+  va-> SetVisibility(true);
+  world_lv-> SetVisAttributes(va);
 
-  const int kNzTracker = 5;
-  const int kNxTracker = 11;
-  const double kZTracker = -20.*cm;
-  int index = 0;
-  for (auto iz = 0; iz < kNzTracker; iz++) {
-    for (auto ix = -kNxTracker; ix <= kNxTracker; ix++) {
-      auto x0 = kDXZ_Voxel * ix;
-      auto z0 = kZTracker + kDXZ_Voxel*iz;
-      auto pvoxel = new G4PVPlacement(0, G4ThreeVector(x0, 0., z0), voxel_lv,
-                                      "voxel", world_lv, false, index);
-      index++;
-    }
+  // geometry footprint, smart voxels are added at run start
+  auto rss1 = ProcStat::GetResidentSize();
+  auto npv = G4PhysicalVolumeStore::GetInstance()-> size();
+  auto nlv = G4LogicalVolumeStore::GetInstance()-> size();
+
+  std::cout << "[ MESSAGE ] ecal geometry : " << ::kLayoutName[layout_];
+  if ( voxel_mother_ ) {
+    std::cout << " (w/ voxel mothers)";
+  } else {
+    std::cout << " (tubes only, " << ::kLayoutName[tube_layout_] << ")";
   }
+  std::cout << ", #PV = " << npv << ", #LV = " << nlv
+            << ", RSS increase = " << rss1 - rss0 << " kB" << std::endl;
+
+  auto report = BenchReport::GetBenchReport();
+  report-> SetString("geometry/layout", ::kLayoutName[layout_]);
+  report-> SetBool("geometry/voxel_mother", voxel_mother_);
+  report-> SetString("geometry/tube_layout", ::kLayoutName[tube_layout_]);
+  report-> SetLong("geometry/physical_volumes", npv);
+  report-> SetLong("geometry/logical_volumes", nlv);
+  report-> SetLong("geometry/volume_kb", rss1 - rss0);
+
+  return world_pv;
+}
+
+// --------------------------------------------------------------------------
+void EcalGeom::ConstructTracker(G4LogicalVolume* world_lv)
+{
+  auto nist_manager = G4NistManager::Instance();
+  auto air = nist_manager-> FindOrBuildMaterial("G4_AIR");
+  auto al = nist_manager-> FindOrBuildMaterial("G4_Al");
 
   // tube tracker
-  const double kTubeInner = 8.5*mm;
-  const double kTubeOuter = 9.5*mm;
   auto tube = new G4Tubs("tube", kTubeInner, kTubeOuter, kDL_Voxel/2.,
                                  0., 360.*deg);
-
-  auto al = nist_manager-> FindOrBuildMaterial("G4_Al");
   auto tube_lv = new G4LogicalVolume(tube, al, "tube");
 
   auto tube_rm = new G4RotationMatrix;
   tube_rm-> rotateX(-90.*deg);
-  auto tube_pv = new G4PVPlacement(tube_rm, G4ThreeVector(), tube_lv, "tube",
-                                   voxel_lv, false, 0);
-  // calorimeter
-  const double kDXY_Cal = 25.*mm;
-  const double kDZ_Cal = 30.*cm;
 
-  auto cal_box = new G4Box("cal", kDXY_Cal/2., kDXY_Cal/2., kDZ_Cal/2.);
-  auto csi = nist_manager-> FindOrBuildMaterial("G4_CESIUM_IODIDE");
+  auto va = new G4VisAttributes(G4Color(0.,0.8,0.8));
+  va-> SetVisibility(true);
+  tube_lv-> SetVisAttributes(va);
 
-  auto cal_lv = new G4LogicalVolume(cal_box, csi, "cal");
+  // envelope for replicated/parameterised layouts
+  const double kZ0_Tracker = kZTracker + kDXZ_Voxel * (kNzTracker-1)/2.;
+  auto build_envelope = [&]() {
+    auto tracker_box = new G4Box("tracker", kNxTracker*kDXZ_Voxel/2.,
+                                 kDL_Voxel/2., kNzTracker*kDXZ_Voxel/2.);
+    auto tracker_lv = new G4LogicalVolume(tracker_box, air, "tracker");
+    new G4PVPlacement(nullptr, G4ThreeVector(0., 0., kZ0_Tracker),
+                      tracker_lv, "tracker", world_lv, false, 0);
+    auto va_env = new G4VisAttributes();
+    va_env-> SetVisibility(false);
+    tracker_lv-> SetVisAttributes(va_env);
+    return tracker_lv;
+  };
 
-  index = 0;
-  const int kNxyCal = 11;
-  const double kZ_Cal = 20.*cm;
-  for (auto ix = -kNxyCal; ix <= kNxyCal; ix++) {
-    for (auto iy = -kNxyCal; iy <= kNxyCal; iy++) {
-      auto x0 = kDXY_Cal * ix;
-      auto y0 = kDXY_Cal * iy;
-      auto cal_pv = new G4PVPlacement(0, G4ThreeVector(x0, y0, kZ_Cal),
-                                      cal_lv, "cal", world_lv, false, index);
-      index++;
+  // tubes are placed in voxels, or laid out themselves
+  tube_layout_ = voxel_mother_ ? kPlacement : layout_;
+
+  // tubes directly placed in the world/envelope
+  if ( ! voxel_mother_ ) {
+    if ( layout_ == kPlacement ) {
+      int index = 0;
+      for (auto iz = 0; iz < kNzTracker; iz++) {
+        for (auto ix = -kNxTracker/2; ix <= kNxTracker/2; ix++) {
+          auto x0 = kDXZ_Voxel * ix;
+          auto z0 = kZTracker + kDXZ_Voxel*iz;
+          new G4PVPlacement(tube_rm, G4ThreeVector(x0, 0., z0), tube_lv,
+                            "tube", world_lv, false, index);
+          index++;
+        }
+      }
+    } else {
+      // replicas/divisions have to fill the mother, so that
+      // bare tubes can only be parameterised
+      if ( layout_ != kParameterised ) {
+        std::cout << "[ WARNING ] EcalGeom::ConstructTracker() "
+                     "tubes w/o voxel mothers cannot be replicated, "
+                     "parameterised instead." << std::endl;
+      }
+      tube_layout_ = kParameterised;
+      auto tracker_lv = build_envelope();
+      auto param = new GridPVP();
+      param-> SetGrid(kNxTracker, kDXZ_Voxel, kNzTracker, kDXZ_Voxel);
+      param-> SetPlane(GridPVP::kXZ);
+      param-> SetRotation(tube_rm);
+      new G4PVParameterised("tube", tube_lv, tracker_lv, kUndefined,
+                            kNxTracker*kNzTracker, param);
     }
+    return;
   }
 
-  // vis attributes
-  auto va = new G4VisAttributes(G4Color(1.,1.,1.));
-  va-> SetVisibility(true);
-  world_lv-> SetVisAttributes(va);
+  // voxel
+  auto voxel_box = new G4Box("voxel", kDXZ_Voxel/2., kDL_Voxel/2.,
+                                      kDXZ_Voxel/2.);
+  auto voxel_lv = new G4LogicalVolume(voxel_box, air, "voxel");
+
+  new G4PVPlacement(tube_rm, G4ThreeVector(), tube_lv, "tube",
+                    voxel_lv, false, 0);
 
   va = new G4VisAttributes(G4Color(0.,0.8,0.8));
   va-> SetVisibility(false);
   voxel_lv-> SetVisAttributes(va);
 
-  va = new G4VisAttributes(G4Color(0.,0.8,0.8));
-  va-> SetVisibility(true);
-  tube_lv-> SetVisAttributes(va);
+  if ( layout_ == kPlacement ) {
+    int index = 0;
+    for (auto iz = 0; iz < kNzTracker; iz++) {
+      for (auto ix = -kNxTracker/2; ix <= kNxTracker/2; ix++) {
+        auto x0 = kDXZ_Voxel * ix;
+        auto z0 = kZTracker + kDXZ_Voxel*iz;
+        new G4PVPlacement(0, G4ThreeVector(x0, 0., z0), voxel_lv,
+                          "voxel", world_lv, false, index);
+        index++;
+      }
+    }
+
+  } else if ( layout_ == kParameterised ) {
+    auto tracker_lv = build_envelope();
+    auto param = new GridPVP();
+    param-> SetGrid(kNxTracker, kDXZ_Voxel, kNzTracker, kDXZ_Voxel);
+    param-> SetPlane(GridPVP::kXZ);
+    new G4PVParameterised("voxel", voxel_lv, tracker_lv, kUndefined,
+                          kNxTracker*kNzTracker, param);
+
+  } else {
+    // layers along z, then voxels along x
+    auto tracker_lv = build_envelope();
+    auto layer_box = new G4Box("tlayer", kNxTracker*kDXZ_Voxel/2.,
+                               kDL_Voxel/2., kDXZ_Voxel/2.);
+    auto layer_lv = new G4LogicalVolume(layer_box, air, "tlayer");
+
+    if ( layout_ == kReplica ) {
+      new G4PVReplica("tlayer", layer_lv, tracker_lv,
+                      kZAxis, kNzTracker, kDXZ_Voxel);
+      new G4PVReplica("voxel", voxel_lv, layer_lv,
+                      kXAxis, kNxTracker, kDXZ_Voxel);
+    } else {
+      new G4PVDivision("tlayer", layer_lv, tracker_lv,
+                       kZAxis, kNzTracker, 0.);
+      new G4PVDivision("voxel", voxel_lv, layer_lv,
+                       kXAxis, kNxTracker, 0.);
+    }
+
+    va = new G4VisAttributes();
+    va-> SetVisibility(false);
+    layer_lv-> SetVisAttributes(va);
+  }
+}
+
+// --------------------------------------------------------------------------
+void EcalGeom::ConstructCalorimeter(G4LogicalVolume* world_lv)
+{
+  auto nist_manager = G4NistManager::Instance();
+  auto air = nist_manager-> FindOrBuildMaterial("G4_AIR");
+  auto csi = nist_manager-> FindOrBuildMaterial("G4_CESIUM_IODIDE");
 
-  va = new G4VisAttributes(G4Color(0.5,0.5,0.));
+  // calorimeter
+  auto cal_box = new G4Box("cal", kDXY_Cal/2., kDXY_Cal/2., kDZ_Cal/2.);
+  auto cal_lv = new G4LogicalVolume(cal_box, csi, "cal");
+
+  auto va = new G4VisAttributes(G4Color(0.5,0.5,0.));
   cal_lv-> SetVisAttributes(va);
 
-  return world_pv;
+  if ( layout_ == kPlacement ) {
+    int index = 0;
+    for (auto ix = -kNxyCal/2; ix <= kNxyCal/2; ix++) {
+      for (auto iy = -kNxyCal/2; iy <= kNxyCal/2; iy++) {
+        auto x0 = kDXY_Cal * ix;
+        auto y0 = kDXY_Cal * iy;
+        new G4PVPlacement(0, G4ThreeVector(x0, y0, kZ_Cal),
+                          cal_lv, "cal", world_lv, false, index);
+        index++;
+      }
+    }
+    return;
+  }
+
+  // envelope of the crystal array
+  auto array_box = new G4Box("calarray", kNxyCal*kDXY_Cal/2.,
+                             kNxyCal*kDXY_Cal/2., kDZ_Cal/2.);
+  auto array_lv = new G4LogicalVolume(array_box, air, "calarray");
+  new G4PVPlacement(nullptr, G4ThreeVector(0., 0., kZ_Cal),
+                    array_lv, "calarray", world_lv, false, 0);
+
+  va = new G4VisAttributes();
+  va-> SetVisibility(false);
+  array_lv-> SetVisAttributes(va);
+
+  if ( layout_ == kParameterised ) {
+    auto param = new GridPVP();
+    param-> SetGrid(kNxyCal, kDXY_Cal, kNxyCal, kDXY_Cal);
+    param-> SetPlane(GridPVP::kXY);
+    new G4PVParameterised("cal", cal_lv, array_lv, kUndefined,
+                          kNxyCal*kNxyCal, param);
+    return;
+  }
+
+  // rows along y, then crystals along x
+  auto row_box = new G4Box("calrow", kNxyCal*kDXY_Cal/2.,
+                           kDXY_Cal/2., kDZ_Cal/2.);
+  auto row_lv = new G4LogicalVolume(row_box, air, "calrow");
+  row_lv-> SetVisAttributes(va);
+
+  if ( layout_ == kReplica ) {
+    new G4PVReplica("calrow", row_lv, array_lv, kYAxis, kNxyCal, kDXY_Cal);
+    new G4PVReplica("cal", cal_lv, row_lv, kXAxis, kNxyCal, kDXY_Cal);
+  } else {
+    new G4PVDivision("calrow", row_lv, array_lv, kYAxis, kNxyCal, 0.);
+    new G4PVDivision("cal", cal_lv, row_lv, kXAxis, kNxyCal, 0.);
+  }
 }
 
 // --------------------------------------------------------------------------
@@ -13,6 +13,7 @@ See the License for more information.
 
 #include "G4VUserDetectorConstruction.hh"
 
+class G4LogicalVolume;
 class SimData;
 
 class EcalGeom : public G4VUserDetectorConstruction {
@@ -20,13 +21,29 @@ public:
   EcalGeom() = default;
   ~EcalGeom() override = default;
 
+  // representation of the tracker voxels and calorimeter crystals
+  enum { kPlacement = 0, kReplica, kParameterised, kDivision };
+
   void SetSimData(SimData* data);
 
+  void SetLayout(int layout);
+  int GetLayout() const;
+
+  // enclose tracker tubes by air voxels
+  void SetVoxelMother(bool val);
+  bool GetVoxelMother() const;
+
   G4VPhysicalVolume* Construct() override;
   void ConstructSDandField() override;
 
 private:
   SimData* simdata_;
+  int layout_ {kPlacement};
+  bool voxel_mother_ {true};
+  int tube_layout_ {kPlacement};  // as built
+
+  void ConstructTracker(G4LogicalVolume* world_lv);
+  void ConstructCalorimeter(G4LogicalVolume* world_lv);
 
 };
 
@@ -36,4 +53,24 @@ inline void EcalGeom::SetSimData(SimData* data)
   simdata_ = data;
 }
 
+inline void EcalGeom::SetLayout(int layout)
+{
+  layout_ = layout;
+}
+
+inline int EcalGeom::GetLayout() const
+{
+  return layout_;
+}
+
+inline void EcalGeom::SetVoxelMother(bool val)
+{
+  voxel_mother_ = val;
+}
+
+inline bool EcalGeom::GetVoxelMother() const
+{
+  return voxel_mother_;
+}
+
 #endif
@@ -0,0 +1,37 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include "G4ThreeVector.hh"
+#include "G4VPhysicalVolume.hh"
+#include "grid_pvp.h"
+
+// --------------------------------------------------------------------------
+GridPVP::GridPVP()
+  : n1_{1}, n2_{1}, d1_{0.}, d2_{0.}, plane_{kXY}, rotation_{nullptr}
+{
+}
+
+// --------------------------------------------------------------------------
+void GridPVP::ComputeTransformation(const int idx,
+                                    G4VPhysicalVolume* physvol) const
+{
+  int i1 = idx % n1_;
+  int i2 = idx / n1_;
+
+  double c1 = d1_ * ( -n1_/2. + i1 + 0.5 );
+  double c2 = d2_ * ( -n2_/2. + i2 + 0.5 );
+
+  if ( plane_ == kXZ ) {
+    physvol-> SetTranslation(G4ThreeVector(c1, 0., c2));
+  } else {
+    physvol-> SetTranslation(G4ThreeVector(c1, c2, 0.));
+  }
+  physvol-> SetRotation(rotation_);
+}
@@ -0,0 +1,61 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef GRID_PVP_H_
+#define GRID_PVP_H_
+
+#include "G4RotationMatrix.hh"
+#include "G4VPVParameterisation.hh"
+
+class G4VPhysicalVolume;
+
+// 2D regular grid of identical volumes, centered in the mother
+class GridPVP : public G4VPVParameterisation {
+public:
+  GridPVP();
+  ~GridPVP() override = default;
+
+  enum { kXY = 0, kXZ };
+
+  void SetGrid(int n1, double d1, int n2, double d2);
+  void SetPlane(int plane);
+  void SetRotation(G4RotationMatrix* rm);
+
+  void ComputeTransformation(const int idx,
+                             G4VPhysicalVolume* physvol) const override;
+
+private:
+  int n1_, n2_;
+  double d1_, d2_;
+  int plane_;
+  G4RotationMatrix* rotation_;
+
+};
+
+// ==========================================================================
+inline void GridPVP::SetGrid(int n1, double d1, int n2, double d2)
+{
+  n1_ = n1;
+  d1_ = d1;
+  n2_ = n2;
+  d2_ = d2;
+}
+
+inline void GridPVP::SetPlane(int plane)
+{
+  plane_ = plane;
+}
+
+inline void GridPVP::SetRotation(G4RotationMatrix* rm)
+{
+  rotation_ = rm;
+}
+
+#endif
@@ -20,6 +20,7 @@ See the License for more information.
 
 #include "version.h"
 #include "common/appbuilder.h"
+#include "common/appsetup.h"
 #include "common/g4environment.h"
 #include "util/jsonparser.h"
 #include "util/timehistory.h"
@@ -184,6 +185,16 @@ int main(int argc, char** argv)
     std::exit(EXIT_FAILURE);
   }
 
+  // replay of captured events, serially one by one
+  auto appsetup = AppSetup::GetAppSetup();
+  if ( appsetup-> IsReplay() ) {
+    qserial = true;
+    nthreads = 1;
+  }
+
+  // memory policy, before large allocations (may re-execute)
+  appsetup-> SetupMemPolicy(argv);
+
   // ----------------------------------------------------------------------
   std::cout << "=============================================================="
             << std::endl;
@@ -208,6 +219,9 @@ int main(int argc, char** argv)
   std::cout << "=============================================================="
             << std::endl;
 
+  // random engine, set before run managers take it as the master engine
+  appsetup-> SetupRandomEngine();
+
   // ----------------------------------------------------------------------
   auto gtimer = TimeHistory::GetTimeHistory();
   gtimer-> ShowClock("[MESSAGE] Start:");
@@ -242,6 +256,9 @@ int main(int argc, char** argv)
     ui_manager-> ApplyCommand(command + init_macro);
   }
 
+  // all captured events, unless fewer are given
+  nhistories = appsetup-> GetNhistories(nhistories);
+
   // start session
   bool qbatch = nhistories > 0;
   if ( qbatch ) {
@@ -0,0 +1,86 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "CLHEP/Random/Ranlux64Engine.h"
+#include "CLHEP/Random/RanluxEngine.h"
+#include "Randomize.hh"
+#include "common/randomengine.h"
+
+// --------------------------------------------------------------------------
+// per-event seeding keeps the luxury level of the selected engine, and
+// gives the same sequence as a reference engine seeded at that level.
+// --------------------------------------------------------------------------
+namespace {
+
+int GetEngineLuxury(CLHEP::HepRandomEngine* engine)
+{
+  if ( auto ranlux = dynamic_cast<CLHEP::RanluxEngine*>(engine) ) {
+    return ranlux-> getLuxury();
+  }
+  if ( auto ranlux64 = dynamic_cast<CLHEP::Ranlux64Engine*>(engine) ) {
+    return ranlux64-> getLuxury();
+  }
+  return -1;
+}
+
+// --------------------------------------------------------------------------
+int CheckEngine(const std::string& name)
+{
+  const long run_seed = 123456789L;
+  const long run_id = 0;
+  const long event_id = 42;
+
+  if ( ! RandomEngine::SetEngine(name) ) return 1;
+  int luxury = RandomEngine::GetLuxury();
+
+  int nerrors = 0;
+  RandomEngine::SeedEvent(run_seed, run_id, event_id);
+  auto engine = G4Random::getTheEngine();
+  if ( GetEngineLuxury(engine) != luxury ) {
+    std::cout << "[ ERROR ] " << name << " : luxury "
+              << GetEngineLuxury(engine) << " after seeding, expected "
+              << luxury << std::endl;
+    nerrors++;
+  }
+
+  long seeds[3];
+  RandomEngine::MakeEventSeeds(run_seed, run_id, event_id, seeds);
+  auto reference = RandomEngine::Create(name);
+  reference-> setSeeds(seeds, luxury);
+  for ( int i = 0; i < 1000; i++ ) {
+    if ( engine-> flat() != reference-> flat() ) {
+      std::cout << "[ ERROR ] " << name << " : sequence differs at "
+                << i << std::endl;
+      nerrors++;
+      break;
+    }
+  }
+  delete reference;
+
+  std::cout << "[ MESSAGE ] " << name << " (luxury " << luxury << ") : "
+            << ( nerrors == 0 ? "OK" : "FAILED" ) << std::endl;
+  return nerrors;
+}
+
+} // end of namespace
+
+// ==========================================================================
+int main()
+{
+  int nerrors = 0;
+  for ( const auto& name : { "Ranlux", "Ranlux4", "Ranlux64", "MixMax" } ) {
+    nerrors += ::CheckEngine(name);
+  }
+
+  return nerrors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
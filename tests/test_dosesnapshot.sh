@@ -0,0 +1,36 @@
+#!/bin/sh -
+# ======================================================================
+#  ThreadSanitizer check of dose snapshots (no Geant4 needed)
+# ======================================================================
+export LANG=C
+
+# ======================================================================
+# functions
+# ======================================================================
+check_error() {
+  if [ $? -ne 0 ]; then
+    exit -1
+  fi
+}
+
+show_line() {
+echo "========================================================================"
+}
+
+# ======================================================================
+# main
+# ======================================================================
+show_line
+echo "@@ Build a harness..."
+mkdir -p build/tests
+c++ -std=c++17 -O1 -g -fsanitize=thread -pthread -Ivgeo \
+    -o build/tests/tsan_dosesnapshot tests/tsan_dosesnapshot.cc \
+    vgeo/dosegrid.cc vgeo/dosesnapshot.cc
+check_error
+
+show_line
+echo "@@ Run a harness..."
+cd build/tests
+TSAN_OPTIONS="halt_on_error=1" ./tsan_dosesnapshot
+
+exit $?
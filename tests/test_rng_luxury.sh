@@ -0,0 +1,44 @@
+#!/bin/sh -
+# ======================================================================
+#  Luxury levels of random engines after event seeding
+# ======================================================================
+export LANG=C
+
+# ======================================================================
+# functions
+# ======================================================================
+check_error() {
+  if [ $? -ne 0 ]; then
+    exit -1
+  fi
+}
+
+show_line() {
+echo "========================================================================"
+}
+
+# ======================================================================
+# main
+# ======================================================================
+. ./tests/ci/g4version.sh
+
+if [ -z $NOG4VERSION ]; then
+  g4path=/opt/geant4/${G4VERSION}
+else
+  g4path=/opt/geant4
+fi
+g4config=${g4path}/bin/geant4-config
+
+show_line
+echo "@@ Build a test..."
+mkdir -p build/tests
+c++ -std=c++17 $(${g4config} --cflags) -I. \
+    -o build/tests/rng_luxury tests/rng_luxury.cc common/randomengine.cc \
+    $(${g4config} --libs)
+check_error
+
+show_line
+echo "@@ Run a test..."
+./build/tests/rng_luxury
+
+exit $?
@@ -0,0 +1,104 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "dosegrid.h"
+#include "dosesnapshot.h"
+
+// --------------------------------------------------------------------------
+// threads fill their own dose grids while the snapshot writer switches
+// banks every few ms. deposits are small integers, so the merged totals
+// must match the reference exactly whatever the merge order.
+// build with -fsanitize=thread to check the bank hand-over.
+// --------------------------------------------------------------------------
+namespace {
+
+const int kNthreads = 4;
+const int kNx = 8, kNy = 8, kNz = 8;
+const long kNhistories = 200000;
+
+void Fill(DoseGrid* grid, int tid, std::vector<double>* ref)
+{
+  const int nvoxels = kNx * kNy * kNz;
+  unsigned int state = 12345 + tid;
+
+  for ( long ih = 0; ih < kNhistories; ih++ ) {
+    for ( int k = 0; k < 4; k++ ) {
+      state = state * 1103515245u + 12345u;
+      int index = (state >> 8) % nvoxels;
+      double edep = 1. + (state >> 28);
+      grid-> AddEdep(index, edep);
+      (*ref)[index] += edep;
+    }
+    grid-> EndOfHistory();
+  }
+
+  // threads done early, the others keep the writer busy
+  grid-> Finish();
+}
+
+} // end of namespace
+
+// ==========================================================================
+int main()
+{
+  const int nvoxels = kNx * kNy * kNz;
+
+  auto grid = new DoseGrid[kNthreads];
+  for ( int i = 0; i < kNthreads; i++ ) grid[i].Allocate(nvoxels);
+
+  DoseSnapshot snapshot;
+  snapshot.SetDoseGrid(grid, kNthreads, kNx, kNy, kNz);
+  snapshot.SetFileName("tsan_dose_snapshot.bin");
+  snapshot.SetInterval(0.005);
+  snapshot.Start();
+
+  std::vector<std::vector<double>> ref(kNthreads,
+                                       std::vector<double>(nvoxels, 0.));
+  std::vector<std::thread> threads;
+  for ( int i = 0; i < kNthreads; i++ ) {
+    threads.emplace_back(::Fill, &grid[i], i, &ref[i]);
+  }
+  for ( auto& thread : threads ) thread.join();
+
+  snapshot.Stop();
+
+  auto sum = snapshot.GetSum();
+  long nhistories = snapshot.GetNhistories();
+  for ( int i = 0; i < kNthreads; i++ ) {
+    for ( int bank = 0; bank < 2; bank++ ) {
+      for ( int j = 0; j < nvoxels; j++ ) sum[j] += grid[i].GetSum(bank)[j];
+    }
+    nhistories += grid[i].GetNhistories();
+  }
+  delete [] grid;
+  std::remove("tsan_dose_snapshot.bin");
+
+  int nerrors = 0;
+  if ( nhistories != kNthreads * kNhistories ) {
+    std::cout << "[ ERROR ] #histories " << nhistories << " != "
+              << kNthreads * kNhistories << std::endl;
+    nerrors++;
+  }
+  for ( int j = 0; j < nvoxels; j++ ) {
+    double expected = 0.;
+    for ( int i = 0; i < kNthreads; i++ ) expected += ref[i][j];
+    if ( sum[j] != expected ) nerrors++;
+  }
+
+  std::cout << "[ MESSAGE ] " << snapshot.GetNsnapshots() << " snapshots, "
+            << nerrors << " errors" << std::endl;
+
+  return nerrors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,139 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include "benchreport.h"
+
+// --------------------------------------------------------------------------
+namespace {
+
+std::mutex mtx;
+
+// --------------------------------------------------------------------------
+void SplitKey(const std::string& key, std::string& group, std::string& name)
+{
+  auto pos = key.find('/');
+  if ( pos == std::string::npos ) {
+    group = "";
+    name = key;
+  } else {
+    group = key.substr(0, pos);
+    name = key.substr(pos+1);
+  }
+}
+
+} // end of namespace
+
+// ==========================================================================
+namespace kut {
+// --------------------------------------------------------------------------
+BenchReport* BenchReport::GetBenchReport()
+{
+  static BenchReport report;
+  return &report;
+}
+
+// --------------------------------------------------------------------------
+void BenchReport::SetBool(const std::string& key, bool val)
+{
+  SetRaw(key, val ? "true" : "false");
+}
+
+// --------------------------------------------------------------------------
+void BenchReport::SetLong(const std::string& key, long val)
+{
+  SetRaw(key, std::to_string(val));
+}
+
+// --------------------------------------------------------------------------
+void BenchReport::SetDouble(const std::string& key, double val)
+{
+  std::stringstream ss;
+  ss << val;
+  SetRaw(key, ss.str());
+}
+
+// --------------------------------------------------------------------------
+void BenchReport::SetString(const std::string& key, const std::string& val)
+{
+  SetRaw(key, "\"" + val + "\"");
+}
+
+// --------------------------------------------------------------------------
+void BenchReport::SetRaw(const std::string& key, const std::string& json_val)
+{
+  std::lock_guard<std::mutex> lock(::mtx);
+  for ( auto& item : items_ ) {
+    if ( item.first == key ) {
+      item.second = json_val;
+      return;
+    }
+  }
+  items_.push_back(std::make_pair(key, json_val));
+}
+
+// --------------------------------------------------------------------------
+bool BenchReport::HasItems() const
+{
+  return ! items_.empty();
+}
+
+// --------------------------------------------------------------------------
+void BenchReport::ShowItems() const
+{
+  std::lock_guard<std::mutex> lock(::mtx);
+  for ( const auto& item : items_ ) {
+    std::cout << " - " << item.first << " = " << item.second << std::endl;
+  }
+}
+
+// --------------------------------------------------------------------------
+void BenchReport::WriteJson(std::ostream& os, const std::string& indent) const
+{
+  std::lock_guard<std::mutex> lock(::mtx);
+
+  // groups in order of first appearance
+  std::vector<std::string> groups;
+  std::string group, name;
+  for ( const auto& item : items_ ) {
+    ::SplitKey(item.first, group, name);
+    bool qfound = false;
+    for ( const auto& g : groups ) {
+      if ( g == group ) qfound = true;
+    }
+    if ( ! qfound ) groups.push_back(group);
+  }
+
+  for ( const auto& g : groups ) {
+    if ( g != "" ) {
+      os << indent << "\"" << g << "\" : {" << std::endl;
+    }
+    bool qfirst = true;
+    for ( const auto& item : items_ ) {
+      ::SplitKey(item.first, group, name);
+      if ( group != g ) continue;
+      if ( g == "" ) {
+        os << indent << "\"" << name << "\" : " << item.second
+           << "," << std::endl;
+      } else {
+        if ( ! qfirst ) os << "," << std::endl;
+        os << indent << indent << "\"" << name << "\" : " << item.second;
+        qfirst = false;
+      }
+    }
+    if ( g != "" ) {
+      os << std::endl << indent << "}," << std::endl;
+    }
+  }
+}
+
+} // end of namespace
@@ -0,0 +1,53 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#ifndef BENCH_REPORT_H_
+#define BENCH_REPORT_H_
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace kut {
+
+// extra items of the benchmark result,
+// keys like "group/name" are grouped into a JSON object
+class BenchReport {
+public:
+  static BenchReport* GetBenchReport();
+  ~BenchReport() = default;
+
+  BenchReport(const BenchReport&) = delete;
+  BenchReport& operator=(const BenchReport&) = delete;
+
+  void SetBool(const std::string& key, bool val);
+  void SetLong(const std::string& key, long val);
+  void SetDouble(const std::string& key, double val);
+  void SetString(const std::string& key, const std::string& val);
+  void SetRaw(const std::string& key, const std::string& json_val);
+
+  bool HasItems() const;
+
+  void ShowItems() const;
+
+  // writes "key" : value entries, each line ends with a comma
+  void WriteJson(std::ostream& os, const std::string& indent = "  ") const;
+
+private:
+  BenchReport() = default;
+
+  std::vector<std::pair<std::string, std::string>> items_;
+
+};
+
+} // end of namespace
+
+#endif
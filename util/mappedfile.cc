@@ -0,0 +1,69 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mappedfile.h"
+
+// ==========================================================================
+namespace kut {
+// --------------------------------------------------------------------------
+MappedFile::MappedFile()
+  : fname_{""}, data_{nullptr}, size_{0}
+{
+}
+
+// --------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+  Close();
+}
+
+// --------------------------------------------------------------------------
+bool MappedFile::Open(const std::string& fname)
+{
+  Close();
+
+  int fd = ::open(fname.c_str(), O_RDONLY);
+  if ( fd < 0 ) return false;
+
+  struct stat st;
+  if ( ::fstat(fd, &st) != 0 || st.st_size == 0 ) {
+    ::close(fd);
+    return false;
+  }
+
+  void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);  // mapping is kept after closing the descriptor
+  if ( addr == MAP_FAILED ) return false;
+
+  ::madvise(addr, st.st_size, MADV_WILLNEED);
+
+  fname_ = fname;
+  data_ = static_cast<const char*>(addr);
+  size_ = st.st_size;
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void MappedFile::Close()
+{
+  if ( data_ != nullptr ) {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+  fname_ = "";
+  data_ = nullptr;
+  size_ = 0;
+}
+
+} // end of namespace
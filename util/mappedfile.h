@@ -0,0 +1,66 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace kut {
+
+// read-only memory mapped file, pages are shared among threads
+class MappedFile {
+public:
+  MappedFile();
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool Open(const std::string& fname);
+  void Close();
+
+  bool IsOpen() const;
+  const char* GetData() const;
+  std::size_t GetSize() const;
+  const std::string& GetFileName() const;
+
+private:
+  std::string fname_;
+  const char* data_;
+  std::size_t size_;
+
+};
+
+// ==========================================================================
+inline bool MappedFile::IsOpen() const
+{
+  return data_ != nullptr;
+}
+
+inline const char* MappedFile::GetData() const
+{
+  return data_;
+}
+
+inline std::size_t MappedFile::GetSize() const
+{
+  return size_;
+}
+
+inline const std::string& MappedFile::GetFileName() const
+{
+  return fname_;
+}
+
+} // end of namespace
+
+#endif
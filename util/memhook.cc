@@ -0,0 +1,294 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "memhook.h"
+
+#ifdef ENABLE_MEMHOOK
+#include <malloc.h>
+#endif
+
+// --------------------------------------------------------------------------
+namespace {
+
+// threads over the limit share the last slot (approximate counts)
+constexpr int kMaxThreads = 1024;
+
+struct alignas(64) Slot {
+  std::atomic<long> nallocs;
+  std::atomic<long> nfrees;
+  std::atomic<long> bytes;
+  std::atomic<long> live;
+  std::atomic<long> peak;
+};
+
+// zero-initialized before any allocation
+Slot slots[kMaxThreads];
+std::atomic<int> nslots {0};
+thread_local int islot = -1;
+
+// --------------------------------------------------------------------------
+inline Slot& GetSlot()
+{
+  if ( ::islot < 0 ) {
+    int i = ::nslots.fetch_add(1, std::memory_order_relaxed);
+    ::islot = std::min(i, ::kMaxThreads - 1);
+  }
+  return ::slots[::islot];
+}
+
+// --------------------------------------------------------------------------
+// written only by the owner thread, read by others
+inline void Add(std::atomic<long>& counter, long val)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + val,
+                std::memory_order_relaxed);
+}
+
+#ifdef ENABLE_MEMHOOK
+// --------------------------------------------------------------------------
+inline void CountAlloc(void* ptr)
+{
+  long size = malloc_usable_size(ptr);
+  auto& slot = ::GetSlot();
+  ::Add(slot.nallocs, 1);
+  ::Add(slot.bytes, size);
+  ::Add(slot.live, size);
+  long live = slot.live.load(std::memory_order_relaxed);
+  if ( live > slot.peak.load(std::memory_order_relaxed) ) {
+    slot.peak.store(live, std::memory_order_relaxed);
+  }
+}
+
+// --------------------------------------------------------------------------
+inline void CountFree(void* ptr)
+{
+  long size = malloc_usable_size(ptr);
+  auto& slot = ::GetSlot();
+  ::Add(slot.nfrees, 1);
+  ::Add(slot.live, -size);
+}
+
+// --------------------------------------------------------------------------
+void* Allocate(std::size_t size, std::size_t alignment = 0)
+{
+  if ( size == 0 ) size = 1;
+
+  void* ptr = nullptr;
+  while ( true ) {
+    if ( alignment == 0 ) {
+      ptr = std::malloc(size);
+    } else if ( posix_memalign(&ptr, alignment, size) != 0 ) {
+      ptr = nullptr;
+    }
+    if ( ptr != nullptr ) break;
+
+    auto handler = std::get_new_handler();
+    if ( handler == nullptr ) throw std::bad_alloc();
+    handler();
+  }
+
+  ::CountAlloc(ptr);
+  return ptr;
+}
+
+// --------------------------------------------------------------------------
+void Deallocate(void* ptr)
+{
+  if ( ptr == nullptr ) return;
+  ::CountFree(ptr);
+  std::free(ptr);
+}
+#endif
+
+} // end of namespace
+
+// ==========================================================================
+#ifdef ENABLE_MEMHOOK
+void* operator new(std::size_t size)
+{
+  return ::Allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+  return ::Allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+  try {
+    return ::Allocate(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+  try {
+    return ::Allocate(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void* operator new(std::size_t size, std::align_val_t al)
+{
+  return ::Allocate(size, static_cast<std::size_t>(al));
+}
+
+void* operator new[](std::size_t size, std::align_val_t al)
+{
+  return ::Allocate(size, static_cast<std::size_t>(al));
+}
+
+void* operator new(std::size_t size, std::align_val_t al,
+                   const std::nothrow_t&) noexcept
+{
+  try {
+    return ::Allocate(size, static_cast<std::size_t>(al));
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void* operator new[](std::size_t size, std::align_val_t al,
+                     const std::nothrow_t&) noexcept
+{
+  try {
+    return ::Allocate(size, static_cast<std::size_t>(al));
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void operator delete(void* ptr) noexcept
+{
+  ::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  ::Deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  ::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+  ::Deallocate(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+  ::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+  ::Deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+  ::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+  ::Deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+  ::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+  ::Deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t,
+                     const std::nothrow_t&) noexcept
+{
+  ::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t,
+                       const std::nothrow_t&) noexcept
+{
+  ::Deallocate(ptr);
+}
+#endif
+
+// ==========================================================================
+namespace kut {
+// --------------------------------------------------------------------------
+bool MemHook::IsEnabled()
+{
+#ifdef ENABLE_MEMHOOK
+  return true;
+#else
+  return false;
+#endif
+}
+
+// --------------------------------------------------------------------------
+MemCount MemHook::GetThreadCount()
+{
+  const auto& slot = ::GetSlot();
+  MemCount count;
+  count.nallocs = slot.nallocs.load(std::memory_order_relaxed);
+  count.nfrees = slot.nfrees.load(std::memory_order_relaxed);
+  count.bytes = slot.bytes.load(std::memory_order_relaxed);
+  count.live = slot.live.load(std::memory_order_relaxed);
+  count.peak = slot.peak.load(std::memory_order_relaxed);
+  return count;
+}
+
+// --------------------------------------------------------------------------
+void MemHook::ResetPeak()
+{
+  auto& slot = ::GetSlot();
+  slot.peak.store(slot.live.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------
+MemCount MemHook::GetTotalCount()
+{
+  MemCount count;
+  int n = std::min(::nslots.load(std::memory_order_relaxed), ::kMaxThreads);
+  for ( int i = 0; i < n; i++ ) {
+    const auto& slot = ::slots[i];
+    count.nallocs += slot.nallocs.load(std::memory_order_relaxed);
+    count.nfrees += slot.nfrees.load(std::memory_order_relaxed);
+    count.bytes += slot.bytes.load(std::memory_order_relaxed);
+    count.live += slot.live.load(std::memory_order_relaxed);
+    count.peak += slot.peak.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+// --------------------------------------------------------------------------
+int MemHook::GetNthreads()
+{
+  return std::min(::nslots.load(std::memory_order_relaxed), ::kMaxThreads);
+}
+
+} // end of namespace
@@ -0,0 +1,44 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#ifndef MEM_HOOK_H_
+#define MEM_HOOK_H_
+
+namespace kut {
+
+// allocation counters (bytes of usable size)
+struct MemCount {
+  long nallocs {0};
+  long nfrees {0};
+  long bytes {0};  // allocated
+  long live {0};   // allocated - freed by the thread
+  long peak {0};   // max of live since ResetPeak()
+};
+
+// counters of global operator new/delete for each thread. the operators
+// are replaced only when built with ENABLE_MEMHOOK, otherwise counters
+// are zero.
+class MemHook {
+public:
+  static bool IsEnabled();
+
+  // calling thread
+  static MemCount GetThreadCount();
+  static void ResetPeak();
+
+  // sum of all threads (peak is the sum of thread peaks)
+  static MemCount GetTotalCount();
+  static int GetNthreads();
+
+};
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,318 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "benchreport.h"
+#include "mempolicy.h"
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __GLIBC__
+#include <gnu/libc-version.h>
+#endif
+
+// --------------------------------------------------------------------------
+namespace {
+
+const char* kThpName[] = { "system", "never", "madvise" };
+const char* kNumaName[] = { "default", "interleave", "bind" };
+
+const char* kHugeTunable = "glibc.malloc.hugetlb";
+
+// node masks up to 1024 nodes
+constexpr int kMaxNodes = 1024;
+constexpr int kMaskBits = 8 * sizeof(unsigned long);
+
+// --------------------------------------------------------------------------
+// node list like "0-3,5"
+std::vector<int> ParseNodeList(const std::string& str)
+{
+  std::vector<int> nodes;
+  std::stringstream ss(str);
+  std::string item;
+  while ( std::getline(ss, item, ',') ) {
+    if ( item.empty() ) continue;
+    int first = -1, last = -1;
+    auto pos = item.find('-');
+    try {
+      first = std::stoi(item.substr(0, pos));
+      last = pos == std::string::npos ? first : std::stoi(item.substr(pos+1));
+    } catch (std::exception&) {
+      continue;
+    }
+    for ( int i = first; i <= last; i++ ) nodes.push_back(i);
+  }
+  return nodes;
+}
+
+// --------------------------------------------------------------------------
+std::vector<int> GetOnlineNodes()
+{
+  std::ifstream ifs("/sys/devices/system/node/online");
+  std::string str;
+  if ( ! (ifs >> str) ) return std::vector<int>{0};
+  auto nodes = ::ParseNodeList(str);
+  if ( nodes.empty() ) nodes.push_back(0);
+  return nodes;
+}
+
+// --------------------------------------------------------------------------
+// selected mode in brackets, like "always [madvise] never"
+std::string GetSystemThp()
+{
+  std::ifstream ifs("/sys/kernel/mm/transparent_hugepage/enabled");
+  std::string word;
+  while ( ifs >> word ) {
+    if ( word.size() > 2 && word.front() == '[' && word.back() == ']' ) {
+      return word.substr(1, word.size() - 2);
+    }
+  }
+  return "unknown";
+}
+
+// --------------------------------------------------------------------------
+bool HasHugeTunable()
+{
+  auto tunables = std::getenv("GLIBC_TUNABLES");
+  return tunables != nullptr && std::strstr(tunables, ::kHugeTunable);
+}
+
+#ifdef __linux__
+// --------------------------------------------------------------------------
+// the tunable is honored by glibc 2.35 or later, and the kernel has to
+// accept MADV_HUGEPAGE (probed on an anonymous mapping)
+bool CheckHugeHeap(std::string& error)
+{
+#ifdef __GLIBC__
+  int major = 0, minor = 0;
+  std::sscanf(gnu_get_libc_version(), "%d.%d", &major, &minor);
+  if ( major < 2 || ( major == 2 && minor < 35 ) ) {
+    error = std::string("glibc ") + gnu_get_libc_version() +
+            " ignores " + ::kHugeTunable;
+    return false;
+  }
+#else
+  error = std::string(::kHugeTunable) + " needs glibc";
+  return false;
+#endif
+
+  if ( ::GetSystemThp() == "never" ) {
+    error = "THP is disabled by the system";
+    return false;
+  }
+
+  constexpr std::size_t kProbeSize = 2 << 20;
+  void* ptr = mmap(nullptr, kProbeSize, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if ( ptr == MAP_FAILED ) {
+    error = std::string("mmap: ") + std::strerror(errno);
+    return false;
+  }
+  bool qadvised = madvise(ptr, kProbeSize, MADV_HUGEPAGE) == 0;
+  if ( ! qadvised ) error = std::string("madvise: ") + std::strerror(errno);
+  munmap(ptr, kProbeSize);
+
+  return qadvised;
+}
+#endif
+
+} // end of namespace
+
+// ==========================================================================
+namespace kut {
+// --------------------------------------------------------------------------
+MemPolicy* MemPolicy::GetMemPolicy()
+{
+  static MemPolicy policy;
+  return &policy;
+}
+
+// --------------------------------------------------------------------------
+MemPolicy::MemPolicy()
+  : thp_{kThpSystem}, thp_applied_{false}, numa_{kNumaDefault},
+    arena_max_{0}, mmap_threshold_{0}, numa_workers_{false},
+    qapplied_{false}
+{
+}
+
+// --------------------------------------------------------------------------
+bool MemPolicy::SetThp(const std::string& name)
+{
+  for ( int i = kThpSystem; i <= kThpMadvise; i++ ) {
+    if ( name == ::kThpName[i] ) {
+      thp_ = static_cast<Thp>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+// --------------------------------------------------------------------------
+bool MemPolicy::SetNuma(const std::string& name)
+{
+  for ( int i = kNumaDefault; i <= kNumaBind; i++ ) {
+    if ( name == ::kNumaName[i] ) {
+      numa_ = static_cast<Numa>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+// --------------------------------------------------------------------------
+void MemPolicy::Apply(char** argv)
+{
+  qapplied_ = true;
+
+#ifdef __linux__
+  // transparent huge pages
+  if ( thp_ == kThpNever ) {
+    if ( prctl(PR_SET_THP_DISABLE, 1, 0, 0, 0) != 0 ) {
+      thp_error_ = std::string("prctl: ") + std::strerror(errno);
+      std::cout << "[ WARNING ] MemPolicy::Apply() failed on disabling THP ("
+                << thp_error_ << ")" << std::endl;
+      thp_ = kThpSystem;
+    } else {
+      thp_applied_ = prctl(PR_GET_THP_DISABLE, 0, 0, 0, 0) == 1;
+      if ( ! thp_applied_ ) thp_error_ = "prctl: THP is not disabled";
+    }
+
+  } else if ( thp_ == kThpMadvise && ! ::HasHugeTunable() ) {
+    // tunables are read only at startup of the process
+    std::string tunables = std::string(::kHugeTunable) + "=1";
+    auto env = std::getenv("GLIBC_TUNABLES");
+    if ( env != nullptr && *env != '\0' ) {
+      tunables = std::string(env) + ":" + tunables;
+    }
+    setenv("GLIBC_TUNABLES", tunables.c_str(), 1);
+
+    std::cout << "[ MESSAGE ] re-executing with GLIBC_TUNABLES="
+              << tunables << std::endl;
+    execv("/proc/self/exe", argv);
+
+    thp_error_ = std::string("execv: ") + std::strerror(errno);
+    std::cout << "[ WARNING ] MemPolicy::Apply() failed on re-execution ("
+              << thp_error_ << "). THP of the heap is not requested."
+              << std::endl;
+    unsetenv("GLIBC_TUNABLES");
+    if ( env != nullptr ) setenv("GLIBC_TUNABLES", env, 1);
+    thp_ = kThpSystem;
+
+  } else if ( thp_ == kThpMadvise ) {
+    // re-executed, the tunable is set but may be ignored
+    thp_applied_ = ::CheckHugeHeap(thp_error_);
+    if ( ! thp_applied_ ) {
+      std::cout << "[ WARNING ] MemPolicy::Apply() THP of the heap is "
+                   "not in effect (" << thp_error_ << ")" << std::endl;
+    }
+
+  } else {
+    thp_applied_ = true;
+  }
+
+  // malloc
+  if ( arena_max_ > 0 && mallopt(M_ARENA_MAX, arena_max_) != 1 ) {
+    std::cout << "[ WARNING ] MemPolicy::Apply() failed on M_ARENA_MAX = "
+              << arena_max_ << std::endl;
+    arena_max_ = 0;
+  }
+
+  if ( mmap_threshold_ > 0 &&
+       mallopt(M_MMAP_THRESHOLD, mmap_threshold_) != 1 ) {
+    std::cout << "[ WARNING ] MemPolicy::Apply() failed on M_MMAP_THRESHOLD = "
+              << mmap_threshold_ << std::endl;
+    mmap_threshold_ = 0;
+  }
+
+  // NUMA policy of this thread
+  if ( numa_ != kNumaDefault ) {
+    if ( numa_nodes_.empty() ) numa_nodes_ = ::GetOnlineNodes();
+
+    unsigned long mask[::kMaxNodes / ::kMaskBits] = {};
+    for ( auto node : numa_nodes_ ) {
+      if ( node < 0 || node >= ::kMaxNodes ) continue;
+      mask[node / ::kMaskBits] |= 1UL << (node % ::kMaskBits);
+    }
+
+    int mode = numa_ == kNumaInterleave ? MPOL_INTERLEAVE : MPOL_BIND;
+    if ( syscall(SYS_set_mempolicy, mode, mask, ::kMaxNodes + 1) != 0 ) {
+      std::cout << "[ WARNING ] MemPolicy::Apply() failed on NUMA policy "
+                << ::kNumaName[numa_] << " (" << std::strerror(errno) << ")"
+                << std::endl;
+      numa_ = kNumaDefault;
+    }
+  }
+#else
+  (void)argv;
+  if ( thp_ != kThpSystem || arena_max_ > 0 || mmap_threshold_ > 0 ||
+       numa_ != kNumaDefault ) {
+    std::cout << "[ WARNING ] MemPolicy::Apply() is supported only on Linux."
+              << std::endl;
+  }
+  thp_ = kThpSystem;
+  thp_applied_ = true;
+  numa_ = kNumaDefault;
+  arena_max_ = 0;
+  mmap_threshold_ = 0;
+#endif
+}
+
+// --------------------------------------------------------------------------
+void MemPolicy::ApplyThread() const
+{
+#ifdef __linux__
+  if ( numa_ == kNumaDefault || numa_workers_ ) return;
+
+  syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0);
+#endif
+}
+
+// --------------------------------------------------------------------------
+void MemPolicy::Report() const
+{
+  if ( ! qapplied_ ) return;
+
+  auto report = BenchReport::GetBenchReport();
+  report-> SetString("mempolicy/thp", ::kThpName[thp_]);
+  report-> SetBool("mempolicy/thp_applied", thp_applied_);
+  report-> SetString("mempolicy/thp_system", ::GetSystemThp());
+  report-> SetBool("mempolicy/thp_heap", thp_ == kThpMadvise && thp_applied_);
+  if ( ! thp_error_.empty() ) {
+    report-> SetString("mempolicy/thp_error", thp_error_);
+  }
+  report-> SetLong("mempolicy/arena_max", arena_max_);
+  report-> SetLong("mempolicy/mmap_threshold", mmap_threshold_);
+  report-> SetString("mempolicy/numa", ::kNumaName[numa_]);
+
+  if ( numa_ != kNumaDefault ) {
+    std::stringstream nodes;
+    for ( std::size_t i = 0; i < numa_nodes_.size(); i++ ) {
+      nodes << (i == 0 ? "[" : ", ") << numa_nodes_[i];
+    }
+    nodes << "]";
+    report-> SetRaw("mempolicy/numa_nodes", nodes.str());
+    report-> SetBool("mempolicy/numa_workers", numa_workers_);
+  }
+}
+
+} // end of namespace
@@ -0,0 +1,93 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#ifndef MEM_POLICY_H_
+#define MEM_POLICY_H_
+
+#include <string>
+#include <vector>
+
+namespace kut {
+
+// memory-system settings of the process (Linux, glibc), applied at startup
+// before large allocations. THP is disabled by prctl, or requested for
+// the malloc heap by the glibc.malloc.hugetlb tunable, which needs
+// a re-execution of the program. NUMA policy is set for the calling
+// (master) thread and inherited by threads created later.
+class MemPolicy {
+public:
+  enum Thp { kThpSystem, kThpNever, kThpMadvise };
+  enum Numa { kNumaDefault, kNumaInterleave, kNumaBind };
+
+  static MemPolicy* GetMemPolicy();
+  ~MemPolicy() = default;
+
+  MemPolicy(const MemPolicy&) = delete;
+  MemPolicy& operator=(const MemPolicy&) = delete;
+
+  // false for an unknown name
+  bool SetThp(const std::string& name);
+  bool SetNuma(const std::string& name);
+
+  void SetArenaMax(int n);  // 0 for the glibc default
+  void SetMmapThreshold(long nbytes);  // 0 for the dynamic threshold
+  void SetNumaNodes(const std::vector<int>& nodes);  // empty for all online
+  void SetNumaWorkers(bool val);  // workers keep the policy of the master
+
+  // process settings and the policy of the calling thread. may not return
+  // for THP of the heap (argv of main)
+  void Apply(char** argv);
+
+  // resets NUMA policy of a worker thread to local allocation
+  void ApplyThread() const;
+
+  // applied settings into the benchmark report, with the reason
+  // when THP is not in effect
+  void Report() const;
+
+private:
+  MemPolicy();
+
+  Thp thp_;
+  bool thp_applied_;
+  std::string thp_error_;
+  Numa numa_;
+  int arena_max_;
+  long mmap_threshold_;
+  std::vector<int> numa_nodes_;
+  bool numa_workers_;
+  bool qapplied_;
+
+};
+
+// ==========================================================================
+inline void MemPolicy::SetArenaMax(int n)
+{
+  arena_max_ = n;
+}
+
+inline void MemPolicy::SetMmapThreshold(long nbytes)
+{
+  mmap_threshold_ = nbytes;
+}
+
+inline void MemPolicy::SetNumaNodes(const std::vector<int>& nodes)
+{
+  numa_nodes_ = nodes;
+}
+
+inline void MemPolicy::SetNumaWorkers(bool val)
+{
+  numa_workers_ = val;
+}
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,125 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#ifndef MPMC_QUEUE_H_
+#define MPMC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace kut {
+
+// bounded lock-free multi-producer multi-consumer queue. each cell
+// carries a sequence number telling whether it is ready to be written
+// or read at the current position (D. Vyukov's algorithm).
+template <typename T>
+class MPMCQueue {
+public:
+  // capacity is rounded up to a power of two
+  explicit MPMCQueue(std::size_t capacity);
+  ~MPMCQueue() = default;
+
+  MPMCQueue(const MPMCQueue&) = delete;
+  MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+  std::size_t GetCapacity() const;
+
+  // false if full / empty, never blocks
+  bool Push(const T& val);
+  bool Pop(T& val);
+
+private:
+  struct Cell {
+    std::atomic<std::size_t> seq;
+    T val;
+  };
+
+  std::size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+
+  // producer and consumer positions on their own cache lines
+  alignas(64) std::atomic<std::size_t> tail_;
+  alignas(64) std::atomic<std::size_t> head_;
+
+};
+
+// ==========================================================================
+template <typename T>
+MPMCQueue<T>::MPMCQueue(std::size_t capacity)
+  : mask_{0}, tail_{0}, head_{0}
+{
+  std::size_t size = 2;
+  while ( size < capacity ) size <<= 1;
+  mask_ = size - 1;
+
+  cells_.reset(new Cell[size]);
+  for ( std::size_t i = 0; i < size; i++ ) {
+    cells_[i].seq.store(i, std::memory_order_relaxed);
+  }
+}
+
+template <typename T>
+inline std::size_t MPMCQueue<T>::GetCapacity() const
+{
+  return mask_ + 1;
+}
+
+template <typename T>
+bool MPMCQueue<T>::Push(const T& val)
+{
+  auto pos = tail_.load(std::memory_order_relaxed);
+  Cell* cell;
+  while ( true ) {
+    cell = &cells_[pos & mask_];
+    auto seq = cell-> seq.load(std::memory_order_acquire);
+    auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+    if ( diff == 0 ) {
+      if ( tail_.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed) ) break;
+    } else if ( diff < 0 ) {
+      return false;
+    } else {
+      pos = tail_.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell-> val = val;
+  cell-> seq.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool MPMCQueue<T>::Pop(T& val)
+{
+  auto pos = head_.load(std::memory_order_relaxed);
+  Cell* cell;
+  while ( true ) {
+    cell = &cells_[pos & mask_];
+    auto seq = cell-> seq.load(std::memory_order_acquire);
+    auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+    if ( diff == 0 ) {
+      if ( head_.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed) ) break;
+    } else if ( diff < 0 ) {
+      return false;
+    } else {
+      pos = head_.load(std::memory_order_relaxed);
+    }
+  }
+
+  val = cell-> val;
+  cell-> seq.store(pos + mask_ + 1, std::memory_order_release);
+  return true;
+}
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,49 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#include <fstream>
+#ifndef _MSC_VER
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+#include "procstat.h"
+
+// ==========================================================================
+namespace kut {
+// --------------------------------------------------------------------------
+long ProcStat::GetResidentSize()
+{
+#ifdef __linux__
+  std::ifstream ifs("/proc/self/statm");
+  long vsize = 0, rss = 0;
+  if ( ifs >> vsize >> rss ) {
+    return rss * ( sysconf(_SC_PAGESIZE) / 1024 );
+  }
+#endif
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+long ProcStat::GetPeakResidentSize()
+{
+#ifndef _MSC_VER
+  struct rusage usage;
+  if ( getrusage(RUSAGE_SELF, &usage) == 0 ) {
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+  }
+#endif
+  return 0;
+}
+
+} // end of namespace
@@ -0,0 +1,29 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#ifndef PROC_STAT_H_
+#define PROC_STAT_H_
+
+namespace kut {
+
+// process memory statistics (kB), zero if not available
+class ProcStat {
+public:
+  ProcStat() = default;
+  ~ProcStat() = default;
+
+  static long GetResidentSize();
+  static long GetPeakResidentSize();
+
+};
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,424 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include "profiler.h"
+
+#ifdef __linux__
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#endif
+
+// ==========================================================================
+namespace kut {
+
+struct Profiler::ThreadBuffer {
+  int capacity {0};
+  int depth {0};
+  std::vector<void*> frames;  // capacity x depth
+  std::vector<int> depths;
+  std::atomic<long> nsamples {0};
+  std::atomic<long> ndropped {0};
+  std::atomic<long> overhead {0};  // ns
+  uintptr_t stack_lo {0}, stack_hi {0};
+#ifdef __linux__
+  timer_t timer {};
+#endif
+  bool qtimer {false};
+};
+
+} // end of namespace
+
+// --------------------------------------------------------------------------
+namespace {
+
+using kut::Profiler;
+
+// signal handler state, fixed at Start()
+Profiler::Unwind unwind = Profiler::kBacktrace;
+
+thread_local Profiler::ThreadBuffer* tbuffer = nullptr;
+
+// handler + signal trampoline
+constexpr int kSkipFrames = 2;
+constexpr int kMaxFrames = 256;
+
+// --------------------------------------------------------------------------
+inline long ThreadCPUTime()
+{
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+#ifdef __linux__
+// --------------------------------------------------------------------------
+int WalkFramePointers(void* context, Profiler::ThreadBuffer* buffer,
+                      void** frames, int depth)
+{
+  // valid for code built with -fno-omit-frame-pointer
+  auto uc = static_cast<ucontext_t*>(context);
+#if defined(__x86_64__)
+  auto pc = static_cast<uintptr_t>(uc-> uc_mcontext.gregs[REG_RIP]);
+  auto fp = static_cast<uintptr_t>(uc-> uc_mcontext.gregs[REG_RBP]);
+#elif defined(__aarch64__)
+  auto pc = static_cast<uintptr_t>(uc-> uc_mcontext.pc);
+  auto fp = static_cast<uintptr_t>(uc-> uc_mcontext.regs[29]);
+#else
+  return 0;
+#endif
+
+  int n = 0;
+  frames[n++] = reinterpret_cast<void*>(pc);
+  while ( n < depth ) {
+    if ( fp < buffer-> stack_lo || fp + 2 * sizeof(void*) > buffer-> stack_hi ||
+         fp % sizeof(void*) != 0 ) break;
+    auto frame = reinterpret_cast<uintptr_t*>(fp);
+    if ( frame[1] == 0 ) break;
+    frames[n++] = reinterpret_cast<void*>(frame[1]);
+    if ( frame[0] <= fp ) break;  // stacks grow down
+    fp = frame[0];
+  }
+  return n;
+}
+
+// --------------------------------------------------------------------------
+void SignalHandler(int, siginfo_t*, void* context)
+{
+  auto buffer = ::tbuffer;
+  if ( buffer == nullptr ) return;
+
+  int saved_errno = errno;
+  long t0 = ::ThreadCPUTime();
+
+  long isample = buffer-> nsamples.load(std::memory_order_relaxed);
+  if ( isample >= buffer-> capacity ) {
+    buffer-> ndropped.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    void** frames = &buffer-> frames[isample * buffer-> depth];
+    int n = 0;
+    if ( ::unwind == Profiler::kFramePointer ) {
+      n = ::WalkFramePointers(context, buffer, frames, buffer-> depth);
+    } else {
+      void* tmp[::kMaxFrames];
+      int ntmp = backtrace(tmp, std::min(buffer-> depth + ::kSkipFrames,
+                                         ::kMaxFrames));
+      for ( int i = ::kSkipFrames; i < ntmp; i++ ) frames[n++] = tmp[i];
+    }
+    buffer-> depths[isample] = n;
+    buffer-> nsamples.store(isample + 1, std::memory_order_release);
+  }
+
+  buffer-> overhead.fetch_add(::ThreadCPUTime() - t0,
+                              std::memory_order_relaxed);
+  errno = saved_errno;
+}
+
+// --------------------------------------------------------------------------
+std::string Symbolize(void* addr)
+{
+  Dl_info info;
+  if ( dladdr(addr, &info) == 0 ) {
+    char str[32];
+    std::snprintf(str, sizeof(str), "[%p]", addr);
+    return str;
+  }
+
+  if ( info.dli_sname != nullptr ) {
+    int status = 0;
+    char* name = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr,
+                                     &status);
+    std::string symbol = status == 0 ? name : info.dli_sname;
+    std::free(name);
+    return symbol;
+  }
+
+  // not exported, module + offset
+  std::string module = info.dli_fname != nullptr ? info.dli_fname : "?";
+  auto pos = module.rfind('/');
+  if ( pos != std::string::npos ) module = module.substr(pos + 1);
+  char str[32];
+  std::snprintf(str, sizeof(str), "+0x%lx",
+                static_cast<unsigned long>(reinterpret_cast<uintptr_t>(addr) -
+                reinterpret_cast<uintptr_t>(info.dli_fbase)));
+  return "[" + module + str + "]";
+}
+#endif
+
+} // end of namespace
+
+// ==========================================================================
+namespace kut {
+// --------------------------------------------------------------------------
+Profiler* Profiler::GetProfiler()
+{
+  static Profiler profiler;
+  return &profiler;
+}
+
+// --------------------------------------------------------------------------
+Profiler::Profiler()
+  : qactive_{false}, frequency_{100}, max_depth_{48},
+    buffer_size_{10000}, unwind_{kBacktrace}, cpu_time0_{0.}
+{
+}
+
+// --------------------------------------------------------------------------
+Profiler::~Profiler()
+{
+  Stop();
+  ::tbuffer = nullptr;
+  for ( auto buffer : buffers_ ) delete buffer;
+}
+
+// --------------------------------------------------------------------------
+bool Profiler::Start()
+{
+#ifdef __linux__
+  if ( qactive_ ) return true;
+
+  if ( frequency_ <= 0 || max_depth_ <= 0 || buffer_size_ <= 0 ) {
+    std::cout << "[ ERROR ] Profiler::Start() invalid settings, "
+              << frequency_ << " Hz, depth = " << max_depth_
+              << ", buffer = " << buffer_size_ << std::endl;
+    return false;
+  }
+  if ( max_depth_ > ::kMaxFrames - ::kSkipFrames ) {
+    max_depth_ = ::kMaxFrames - ::kSkipFrames;
+  }
+
+  // backtrace() loads libgcc at its first call, not in a handler
+  void* tmp[4];
+  backtrace(tmp, 4);
+
+  ::unwind = unwind_;
+
+  struct sigaction action {};
+  action.sa_sigaction = ::SignalHandler;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if ( sigaction(SIGPROF, &action, nullptr) != 0 ) {
+    std::cout << "[ ERROR ] Profiler::Start() "
+                 "cannot install a SIGPROF handler" << std::endl;
+    return false;
+  }
+
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  cpu_time0_ = ts.tv_sec + ts.tv_nsec * 1.e-9;
+
+  qactive_ = true;
+  return true;
+#else
+  std::cout << "[ WARNING ] Profiler::Start() "
+               "sampling profiler is available only on Linux" << std::endl;
+  return false;
+#endif
+}
+
+// --------------------------------------------------------------------------
+void Profiler::RegisterThread()
+{
+#ifdef __linux__
+  if ( ! qactive_ ) return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto buffer = ::tbuffer;
+  if ( buffer == nullptr ) {
+    buffer = new ThreadBuffer();
+    buffer-> capacity = buffer_size_;
+    buffer-> depth = max_depth_;
+    buffer-> frames.resize(static_cast<size_t>(buffer_size_) * max_depth_);
+    buffer-> depths.resize(buffer_size_);
+
+    pthread_attr_t attr;
+    if ( pthread_getattr_np(pthread_self(), &attr) == 0 ) {
+      void* addr = nullptr;
+      size_t size = 0;
+      pthread_attr_getstack(&attr, &addr, &size);
+      buffer-> stack_lo = reinterpret_cast<uintptr_t>(addr);
+      buffer-> stack_hi = buffer-> stack_lo + size;
+      pthread_attr_destroy(&attr);
+    }
+
+    buffers_.push_back(buffer);
+    ::tbuffer = buffer;
+  }
+  if ( buffer-> qtimer ) return;
+
+  // CPU time of this thread, signaled to this thread
+  struct sigevent sev {};
+  sev.sigev_notify = SIGEV_THREAD_ID;
+  sev.sigev_signo = SIGPROF;
+  sev.sigev_notify_thread_id = static_cast<pid_t>(syscall(SYS_gettid));
+  if ( timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &buffer-> timer) != 0 ) {
+    std::cout << "[ WARNING ] Profiler::RegisterThread() "
+                 "cannot create a timer" << std::endl;
+    return;
+  }
+
+  long interval = 1000000000L / frequency_;
+  struct itimerspec its {};
+  its.it_interval.tv_sec = interval / 1000000000L;
+  its.it_interval.tv_nsec = interval % 1000000000L;
+  its.it_value = its.it_interval;
+  timer_settime(buffer-> timer, 0, &its, nullptr);
+  buffer-> qtimer = true;
+#endif
+}
+
+// --------------------------------------------------------------------------
+void Profiler::UnregisterThread()
+{
+#ifdef __linux__
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto buffer = ::tbuffer;
+  if ( buffer == nullptr || ! buffer-> qtimer ) return;
+
+  timer_delete(buffer-> timer);
+  buffer-> qtimer = false;
+#endif
+}
+
+// --------------------------------------------------------------------------
+void Profiler::Stop()
+{
+#ifdef __linux__
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // timers are owned by the process, deleted from any thread
+  for ( auto buffer : buffers_ ) {
+    if ( buffer-> qtimer ) {
+      timer_delete(buffer-> timer);
+      buffer-> qtimer = false;
+    }
+  }
+#endif
+}
+
+// --------------------------------------------------------------------------
+bool Profiler::WriteFolded(const std::string& fname) const
+{
+#ifdef __linux__
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::unordered_map<void*, std::string> symbols;
+  auto symbol = [&symbols](void* addr) -> const std::string& {
+    auto itr = symbols.find(addr);
+    if ( itr == symbols.end() ) {
+      itr = symbols.emplace(addr, ::Symbolize(addr)).first;
+    }
+    return itr-> second;
+  };
+
+  // root first, return addresses point after the call
+  std::map<std::string, long> stacks;
+  for ( auto buffer : buffers_ ) {
+    long nsamples = buffer-> nsamples.load(std::memory_order_acquire);
+    for ( long i = 0; i < nsamples; i++ ) {
+      void* const* frames = &buffer-> frames[i * buffer-> depth];
+      int n = buffer-> depths[i];
+      if ( n == 0 ) continue;
+      std::string stack;
+      for ( int j = n - 1; j >= 0; j-- ) {
+        auto addr = static_cast<char*>(frames[j]);
+        stack += symbol(j == 0 ? addr : addr - 1);
+        if ( j > 0 ) stack += ';';
+      }
+      stacks[stack]++;
+    }
+  }
+
+  std::ofstream ofs(fname, std::ios::out);
+  if ( ! ofs ) {
+    std::cout << "[ WARNING ] Profiler::WriteFolded() "
+                 "cannot open a profile file, " << fname << std::endl;
+    return false;
+  }
+  for ( const auto& stack : stacks ) {
+    ofs << stack.first << " " << stack.second << std::endl;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+// --------------------------------------------------------------------------
+int Profiler::GetNthreads() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return buffers_.size();
+}
+
+// --------------------------------------------------------------------------
+long Profiler::GetNsamples() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  long nsamples = 0;
+  for ( auto buffer : buffers_ ) {
+    nsamples += buffer-> nsamples.load(std::memory_order_acquire);
+  }
+  return nsamples;
+}
+
+// --------------------------------------------------------------------------
+long Profiler::GetNdropped() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  long ndropped = 0;
+  for ( auto buffer : buffers_ ) {
+    ndropped += buffer-> ndropped.load(std::memory_order_relaxed);
+  }
+  return ndropped;
+}
+
+// --------------------------------------------------------------------------
+double Profiler::GetOverhead() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  long overhead = 0;
+  for ( auto buffer : buffers_ ) {
+    overhead += buffer-> overhead.load(std::memory_order_relaxed);
+  }
+  return overhead * 1.e-9;
+}
+
+// --------------------------------------------------------------------------
+double Profiler::GetProcessTime() const
+{
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1.e-9 - cpu_time0_;
+}
+
+} // end of namespace
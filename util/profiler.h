@@ -0,0 +1,119 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace kut {
+
+// sampling profiler (Linux). each registered thread has a CPU-time timer
+// sending SIGPROF, the handler stores a backtrace into a buffer of the
+// thread, and stacks of all threads are written in the folded format
+// (flamegraph.pl, speedscope).
+class Profiler {
+public:
+  enum Unwind { kBacktrace, kFramePointer };
+
+  // samples of one thread, written only by its signal handler
+  struct ThreadBuffer;
+
+  static Profiler* GetProfiler();
+  ~Profiler();
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+
+  // settings before Start()
+  void SetFrequency(int hz);
+  void SetMaxDepth(int n);
+  void SetBufferSize(int nsamples);  // per thread
+  void SetUnwind(Unwind type);
+
+  int GetFrequency() const;
+  Unwind GetUnwind() const;
+
+  // installs the signal handler
+  bool Start();
+  bool IsActive() const;
+
+  // timer of the calling thread
+  void RegisterThread();
+  void UnregisterThread();
+
+  // stops timers of all threads
+  void Stop();
+
+  // samples taken so far (safe while sampling)
+  bool WriteFolded(const std::string& fname) const;
+
+  int GetNthreads() const;
+  long GetNsamples() const;
+  long GetNdropped() const;
+  double GetOverhead() const;  // sec in the handler, all threads
+  double GetProcessTime() const;  // CPU sec of the process since Start()
+
+private:
+  Profiler();
+
+  bool qactive_;
+  int frequency_;
+  int max_depth_;
+  int buffer_size_;
+  Unwind unwind_;
+  double cpu_time0_;
+
+  mutable std::mutex mutex_;
+  std::vector<ThreadBuffer*> buffers_;
+
+};
+
+// ==========================================================================
+inline void Profiler::SetFrequency(int hz)
+{
+  frequency_ = hz;
+}
+
+inline void Profiler::SetMaxDepth(int n)
+{
+  max_depth_ = n;
+}
+
+inline void Profiler::SetBufferSize(int nsamples)
+{
+  buffer_size_ = nsamples;
+}
+
+inline void Profiler::SetUnwind(Unwind type)
+{
+  unwind_ = type;
+}
+
+inline int Profiler::GetFrequency() const
+{
+  return frequency_;
+}
+
+inline Profiler::Unwind Profiler::GetUnwind() const
+{
+  return unwind_;
+}
+
+inline bool Profiler::IsActive() const
+{
+  return qactive_;
+}
+
+} // end of namespace
+
+#endif
@@ -74,6 +74,17 @@ double Stopwatch::Split()
   return sec;
 }
 
+// --------------------------------------------------------------------------
+double Stopwatch::Peek() const
+{
+  // real elapsed time w/o taking a split, safe to call from any thread
+  auto now = g_clock::now();
+  double sec = std::chrono::duration_cast<std::chrono::nanoseconds>
+               (now-start_clock_).count();
+  sec *= 1.e-9;
+  return sec;
+}
+
 // --------------------------------------------------------------------------
 double Stopwatch::GetRealElapsed() const
 {
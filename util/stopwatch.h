@@ -50,6 +50,7 @@ public:
 
   void Reset();
   double Split();
+  double Peek() const;
 
   double GetRealElapsed() const;
   double GetSystemElapsed() const;
@@ -53,6 +53,12 @@ double TimeHistory::TakeSplit()
   return t1;
 }
 
+// --------------------------------------------------------------------------
+double TimeHistory::GetElapsed() const
+{
+  return sw_.Peek() - t0_;
+}
+
 // --------------------------------------------------------------------------
 bool TimeHistory::FindAKey(const std::string& key) const
 {
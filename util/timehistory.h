@@ -29,6 +29,8 @@ public:
 
   double TakeSplit();
 
+  double GetElapsed() const;
+
   bool FindAKey(const std::string& key) const;
 
   double GetTime(const std::string& key) const;
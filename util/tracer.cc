@@ -0,0 +1,227 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include "tracer.h"
+
+// ==========================================================================
+namespace kut {
+
+struct Tracer::ThreadBuffer {
+  struct Span {
+    const char* name;
+    long id;
+    int64_t begin;  // ns
+    int64_t end;
+  };
+
+  std::string name;
+  std::vector<Span> spans;
+  std::atomic<long> nspans {0};
+  std::atomic<long> ndropped {0};
+
+  Span open[kMaxDepth];
+  int depth {0};
+};
+
+} // end of namespace
+
+// --------------------------------------------------------------------------
+namespace {
+
+thread_local kut::Tracer::ThreadBuffer* tbuffer = nullptr;
+
+// --------------------------------------------------------------------------
+void WriteEscaped(std::ostream& os, const std::string& str)
+{
+  for ( auto c : str ) {
+    if ( c == '"' || c == '\\' ) os << '\\';
+    os << c;
+  }
+}
+
+} // end of namespace
+
+// ==========================================================================
+namespace kut {
+// --------------------------------------------------------------------------
+Tracer* Tracer::GetTracer()
+{
+  static Tracer tracer;
+  return &tracer;
+}
+
+// --------------------------------------------------------------------------
+Tracer::Tracer()
+  : qenabled_{false}, buffer_size_{20000}, sampling_{1}
+{
+}
+
+// --------------------------------------------------------------------------
+Tracer::~Tracer()
+{
+  ::tbuffer = nullptr;
+  for ( auto buffer : buffers_ ) delete buffer;
+}
+
+// --------------------------------------------------------------------------
+void Tracer::Enable()
+{
+  t0_ = n_clock::now();
+  qenabled_ = true;
+}
+
+// --------------------------------------------------------------------------
+Tracer::ThreadBuffer* Tracer::GetThreadBuffer()
+{
+  if ( ::tbuffer != nullptr ) return ::tbuffer;
+
+  // first span of this thread
+  auto buffer = new ThreadBuffer();
+  buffer-> spans.resize(buffer_size_);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffer-> name = "thread " + std::to_string(buffers_.size());
+  buffers_.push_back(buffer);
+  ::tbuffer = buffer;
+
+  return buffer;
+}
+
+// --------------------------------------------------------------------------
+void Tracer::SetThreadName(const std::string& name)
+{
+  if ( ! qenabled_ ) return;
+
+  auto buffer = GetThreadBuffer();
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffer-> name = name;
+}
+
+// --------------------------------------------------------------------------
+void Tracer::Begin(const char* name, long id)
+{
+  if ( ! qenabled_ ) return;
+
+  auto buffer = GetThreadBuffer();
+  if ( buffer-> depth >= kMaxDepth ) {
+    buffer-> depth++;
+    return;
+  }
+
+  auto& span = buffer-> open[buffer-> depth++];
+  span.name = name;
+  span.id = id;
+  span.begin = std::chrono::duration_cast<std::chrono::nanoseconds>
+               (n_clock::now() - t0_).count();
+}
+
+// --------------------------------------------------------------------------
+void Tracer::End()
+{
+  if ( ! qenabled_ ) return;
+
+  auto buffer = GetThreadBuffer();
+  if ( buffer-> depth == 0 ) return;
+
+  buffer-> depth--;
+  if ( buffer-> depth >= kMaxDepth ) {
+    buffer-> ndropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  long ispan = buffer-> nspans.load(std::memory_order_relaxed);
+  if ( ispan >= static_cast<long>(buffer-> spans.size()) ) {
+    buffer-> ndropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  auto& span = buffer-> spans[ispan];
+  span = buffer-> open[buffer-> depth];
+  span.end = std::chrono::duration_cast<std::chrono::nanoseconds>
+             (n_clock::now() - t0_).count();
+  buffer-> nspans.store(ispan + 1, std::memory_order_release);
+}
+
+// --------------------------------------------------------------------------
+bool Tracer::WriteJson(const std::string& fname) const
+{
+  std::ofstream ofs(fname, std::ios::out);
+  if ( ! ofs ) {
+    std::cout << "[ WARNING ] Tracer::WriteJson() "
+                 "cannot open a trace file, " << fname << std::endl;
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // complete events ("X") in usec, one track per thread
+  ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+  bool qfirst = true;
+  for ( std::size_t tid = 0; tid < buffers_.size(); tid++ ) {
+    auto buffer = buffers_[tid];
+    if ( ! qfirst ) ofs << "," << std::endl;
+    qfirst = false;
+    ofs << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << tid
+        << ",\"args\":{\"name\":\"";
+    ::WriteEscaped(ofs, buffer-> name);
+    ofs << "\"}}";
+
+    long nspans = buffer-> nspans.load(std::memory_order_acquire);
+    for ( long i = 0; i < nspans; i++ ) {
+      const auto& span = buffer-> spans[i];
+      ofs << "," << std::endl
+          << "{\"name\":\"" << span.name << "\",\"ph\":\"X\",\"pid\":0"
+          << ",\"tid\":" << tid
+          << ",\"ts\":" << span.begin / 1000 << "." << span.begin / 100 % 10
+          << ",\"dur\":" << (span.end - span.begin) / 1000 << "."
+          << (span.end - span.begin) / 100 % 10;
+      if ( span.id >= 0 ) ofs << ",\"args\":{\"id\":" << span.id << "}";
+      ofs << "}";
+    }
+  }
+  ofs << std::endl << "]}" << std::endl;
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+int Tracer::GetNthreads() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return buffers_.size();
+}
+
+// --------------------------------------------------------------------------
+long Tracer::GetNspans() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  long nspans = 0;
+  for ( auto buffer : buffers_ ) {
+    nspans += buffer-> nspans.load(std::memory_order_acquire);
+  }
+  return nspans;
+}
+
+// --------------------------------------------------------------------------
+long Tracer::GetNdropped() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  long ndropped = 0;
+  for ( auto buffer : buffers_ ) {
+    ndropped += buffer-> ndropped.load(std::memory_order_relaxed);
+  }
+  return ndropped;
+}
+
+} // end of namespace
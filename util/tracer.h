@@ -0,0 +1,104 @@
+/*============================================================================
+  Copyright 2017-2022 Koichi Murakami
+
+  Distributed under the OSI-approved BSD License (the "License");
+  see accompanying file License for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the License for more information.
+============================================================================*/
+#ifndef TRACER_H_
+#define TRACER_H_
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace kut {
+
+// timeline of spans (begin/end) recorded into a buffer of each thread,
+// written as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+// span names have to be string literals.
+class Tracer {
+public:
+  // spans of one thread, written only by that thread
+  struct ThreadBuffer;
+
+  static Tracer* GetTracer();
+  ~Tracer();
+
+  Tracer(const Tracer&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+
+  // settings before Enable()
+  void SetBufferSize(int nspans);  // per thread
+  void SetSampling(int n);         // every n-th event
+
+  void Enable();
+  bool IsEnabled() const;
+
+  int GetSampling() const;
+  bool IsSampled(long id) const;
+
+  // spans of the calling thread, nested up to kMaxDepth
+  void SetThreadName(const std::string& name);
+  void Begin(const char* name, long id = -1);
+  void End();
+
+  // spans closed so far
+  bool WriteJson(const std::string& fname) const;
+
+  int GetNthreads() const;
+  long GetNspans() const;
+  long GetNdropped() const;
+
+  static constexpr int kMaxDepth = 8;
+
+private:
+  Tracer();
+
+  using n_clock = std::chrono::steady_clock;
+
+  bool qenabled_;
+  int buffer_size_;
+  int sampling_;
+  n_clock::time_point t0_;
+
+  mutable std::mutex mutex_;
+  std::vector<ThreadBuffer*> buffers_;
+
+  ThreadBuffer* GetThreadBuffer();
+
+};
+
+// ==========================================================================
+inline void Tracer::SetBufferSize(int nspans)
+{
+  buffer_size_ = nspans;
+}
+
+inline void Tracer::SetSampling(int n)
+{
+  sampling_ = n > 0 ? n : 1;
+}
+
+inline bool Tracer::IsEnabled() const
+{
+  return qenabled_;
+}
+
+inline int Tracer::GetSampling() const
+{
+  return sampling_;
+}
+
+inline bool Tracer::IsSampled(long id) const
+{
+  return qenabled_ && id % sampling_ == 0;
+}
+
+} // end of namespace
+
+#endif
@@ -10,19 +10,34 @@ See the License for more information.
 ============================================================================*/
 #include <vector>
 #include "QGSP_BIC.hh"
+#include "G4Geantino.hh"
 #include "G4ParticleGun.hh"
 #include "G4ParticleTable.hh"
 #include "G4RunManager.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+#include "ctphantom.h"
+#include "dosegrid.h"
+#include "dosesnapshot.h"
 #include "medicalbeam.h"
+#include "phasespace.h"
+#include "phsprecorder.h"
+#include "planestepaction.h"
 #include "voxelgeom.h"
+#include "voxelrunaction.h"
 #include "common/appbuilder.h"
+#include "common/appsetup.h"
 #include "common/eventaction.h"
 #include "common/particlegun.h"
+#include "common/primaryaction.h"
+#include "common/rayshooter.h"
 #include "common/runaction.h"
 #include "common/simdata.h"
 #include "common/stepaction.h"
+#include "common/workerinit.h"
+#include "util/benchreport.h"
 #include "util/jsonparser.h"
+#include "util/tracer.h"
 
 using namespace kut;
 
@@ -31,12 +46,62 @@ namespace {
 
 G4RunManager* run_manager {nullptr};
 JsonParser* jparser {nullptr};
+AppSetup* appsetup {nullptr};
+CTPhantom* phantom {nullptr};  // owned by the geometry
+DoseGrid* dose_grid {nullptr};
+DoseSnapshot* dose_snapshot {nullptr};
+PhaseSpaceFile* phsp_file {nullptr};
+PhspRecorder* phsp_recorder {nullptr};
 
 // --------------------------------------------------------------------------
 void SetupGeomtry(SimData* data)
 {
   auto geom = new VoxelGeom();
   geom-> SetSimData(data);
+
+  if ( ::jparser-> Contains("Phantom/layout") ) {
+    auto layout = ::jparser-> GetStringValue("Phantom/layout");
+    if ( layout == "nested" ) {
+      geom-> SetLayout(VoxelGeom::kNested);
+    } else if ( layout == "regular" ) {
+      geom-> SetLayout(VoxelGeom::kRegular);
+    } else {
+      std::cout << "[ ERROR ] SetupGeomtry() "
+                   "invalid phantom layout, " << layout << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  ::phantom = new CTPhantom();
+  auto phantom = ::phantom;
+  if ( ::jparser-> Contains("Phantom/file") &&
+       ::jparser-> GetStringValue("Phantom/file") != "" ) {
+    if ( ! phantom-> Load(::jparser-> GetStringValue("Phantom/file")) ) {
+      std::exit(EXIT_FAILURE);
+    }
+  } else {
+    std::vector<int> nvec { 61, 61, 150 };
+    std::vector<double> dvec { 5., 5., 2. };
+    if ( ::jparser-> Contains("Phantom/voxels") ) {
+      nvec.clear();
+      ::jparser-> GetIntArray("Phantom/voxels", nvec);
+    }
+    if ( ::jparser-> Contains("Phantom/voxel_size") ) {
+      dvec.clear();
+      ::jparser-> GetDoubleArray("Phantom/voxel_size", dvec);
+    }
+    if ( nvec.size() != 3 || dvec.size() != 3 ||
+         nvec[0] <= 0 || nvec[1] <= 0 || nvec[2] <= 0 ) {
+      std::cout << "[ ERROR ] SetupGeomtry() "
+                   "invalid phantom voxels." << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    phantom-> SetHomogeneous(nvec[0], nvec[1], nvec[2],
+                             dvec[0]*mm, dvec[1]*mm, dvec[2]*mm);
+  }
+  geom-> SetPhantomData(phantom);
+  geom-> SetDoseGrid(::dose_grid);
+
   ::run_manager-> SetUserInitialization(geom);
 }
 
@@ -66,6 +131,7 @@ G4VUserPrimaryGeneratorAction* SetupParticleGun()
   auto pname = ::jparser-> GetStringValue("Primary/Gun/particle");
   auto ptable = G4ParticleTable::GetParticleTable();
   auto pdef = ptable-> FindParticle(pname);
+  if ( ::appsetup-> GetRunMode() == "geantino" ) pdef = G4Geantino::Geantino();
   if ( pdef != nullptr ) gun-> SetParticleDefinition(pdef);
 
   auto pkin = ::jparser-> GetDoubleValue("Primary/Gun/energy");
@@ -89,6 +155,53 @@ G4VUserPrimaryGeneratorAction* SetupParticleGun()
   return pga;
 }
 
+// --------------------------------------------------------------------------
+void LoadPhaseSpace()
+{
+  // mapped once by the master, read by sources of all threads
+  if ( ::jparser-> GetStringValue("Primary/type") != "phsp" ) return;
+
+  auto fname = ::jparser-> GetStringValue("Primary/Phsp/file");
+  ::phsp_file = new PhaseSpaceFile();
+  if ( ! ::phsp_file-> Open(fname) ) {
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::cout << "[ MESSAGE ] phase-space file : " << fname << " ("
+            << ::phsp_file-> GetNparticles() << " particles)" << std::endl;
+  auto report = BenchReport::GetBenchReport();
+  report-> SetString("primary/phsp_file", fname);
+  report-> SetLong("primary/phsp_particles", ::phsp_file-> GetNparticles());
+
+  if ( ::appsetup-> IsReplay() ) {
+    std::cout << "[ WARNING ] LoadPhaseSpace() phase-space particles are "
+                 "not replayed, only the engine state is" << std::endl;
+  }
+}
+
+// --------------------------------------------------------------------------
+G4VUserPrimaryGeneratorAction* SetupPhaseSpace(int nthreads)
+{
+  // threads read interleaved particles, tid, tid + nthreads, ...
+  int tid = G4Threading::G4GetThreadId();
+  if ( tid == G4Threading::MASTER_ID ) tid = 0;
+
+  auto source = new PhaseSpaceSource(::phsp_file, tid, nthreads);
+
+  int recycle = 1;
+  if ( ::jparser-> Contains("Primary/Phsp/recycle") ) {
+    recycle = ::jparser-> GetIntValue("Primary/Phsp/recycle");
+  }
+  bool rotate = false;
+  if ( ::jparser-> Contains("Primary/Phsp/rotate") ) {
+    rotate = ::jparser-> GetBoolValue("Primary/Phsp/rotate");
+  }
+  source-> SetRecycle(recycle, rotate);
+  source-> SetEventIndexing(::appsetup-> IsReproducible());
+
+  return source;
+}
+
 // --------------------------------------------------------------------------
 G4VUserPrimaryGeneratorAction* SetupMedicalBeam()
 {
@@ -104,8 +217,13 @@ G4VUserPrimaryGeneratorAction* SetupMedicalBeam()
 
  if ( pname  == "gamma" ) {
    beam-> SetParticle(MedicalBeam::kPhoton);
-   auto voltage = ::jparser-> GetIntValue("Primary/Beam/photon_voltage");
-   beam-> SetPhotonVoltage(voltage);
+   auto spectrum = ::appsetup-> GetEnergySpectrum();
+   if ( spectrum != nullptr ) {
+     beam-> SetSpectrum(spectrum);
+   } else {
+     auto voltage = ::jparser-> GetIntValue("Primary/Beam/photon_voltage");
+     beam-> SetPhotonVoltage(voltage);
+   }
  } else if ( pname == "e-") {
    beam-> SetParticle(MedicalBeam::kElectron);
    auto ekin = ::jparser-> GetDoubleValue("Primary/Beam/energy");
@@ -128,11 +246,23 @@ G4VUserPrimaryGeneratorAction* SetupMedicalBeam()
    beam-> SetFieldSize(fxy * cm);
  }
 
+ // batched generation, draws ahead across events (no per-event state)
+ bool qstate = ::appsetup-> IsReproducible() ||
+               ::appsetup-> GetEventCapture() != nullptr ||
+               ::appsetup-> IsReplay();
+ if ( ::jparser-> Contains("Primary/Beam/batch") && ! qstate ) {
+   beam-> SetBatchSize(::jparser-> GetIntValue("Primary/Beam/batch"));
+ }
+
+ if ( ::appsetup-> GetRunMode() == "geantino" ) {
+   beam-> SetParticle(MedicalBeam::kGeantino);
+ }
+
  return beam;
 }
 
 // --------------------------------------------------------------------------
-G4VUserPrimaryGeneratorAction* SetupPGA()
+G4VUserPrimaryGeneratorAction* SetupPGA(int nthreads)
 {
   G4VUserPrimaryGeneratorAction* pga {nullptr};
 
@@ -143,6 +273,9 @@ G4VUserPrimaryGeneratorAction* SetupPGA()
   } else if ( primary_type == "beam" ) {
     std::cout << "[ MESSAGE ] primary type : beam" << std::endl;
     pga = SetupMedicalBeam();
+  } else if ( primary_type == "phsp" ) {
+    std::cout << "[ MESSAGE ] primary type : phsp" << std::endl;
+    pga = SetupPhaseSpace(nthreads);
   } else {
     std::cout << "[ MESSAGE ] primary type : gun" << std::endl;
     pga = SetupParticleGun();
@@ -151,6 +284,78 @@ G4VUserPrimaryGeneratorAction* SetupPGA()
   return pga;
 }
 
+// --------------------------------------------------------------------------
+G4VUserPrimaryGeneratorAction* SetupRayShooter(SimData* data)
+{
+  auto shooter = new RayShooter();
+  shooter-> SetSimData(data);
+
+  // rays start from the gun position or the beam source
+  auto primary_type = ::jparser-> GetStringValue("Primary/type");
+  if ( primary_type == "beam" ) {
+    const double kZoffset = 35. * cm;
+    double ssd = 100. * cm;
+    if ( ::jparser-> Contains("Primary/Beam/ssd") ) {
+      ssd = ::jparser-> GetDoubleValue("Primary/Beam/ssd") * cm;
+    }
+    shooter-> SetOrigin(G4ThreeVector(0., 0., kZoffset - ssd));
+  } else {
+    shooter-> SetOrigin(GetPrimaryPosition());
+    if ( ::jparser-> Contains("Primary/Gun/direction") ) {
+      std::vector<double> dvec;
+      ::jparser-> GetDoubleArray("Primary/Gun/direction", dvec);
+      shooter-> SetDirection(G4ThreeVector(dvec[0], dvec[1], dvec[2]));
+    }
+  }
+
+  if ( ::jparser-> Contains("Navigation/rays") ) {
+    shooter-> SetRaysPerEvent(::jparser-> GetIntValue("Navigation/rays"));
+  }
+
+  if ( ::jparser-> Contains("Navigation/spread") ) {
+    std::vector<double> dvec;
+    ::jparser-> GetDoubleArray("Navigation/spread", dvec);
+    shooter-> SetSpread(dvec[0]*cm, dvec[1]*cm);
+  }
+
+  return shooter;
+}
+
+// --------------------------------------------------------------------------
+RunAction* CreateRunAction(int nvec)
+{
+  if ( ::dose_grid == nullptr && ::phsp_recorder == nullptr ) {
+    return new RunAction();
+  }
+
+  auto runaction = new VoxelRunAction();
+  if ( ::phsp_recorder != nullptr ) {
+    runaction-> SetPhspRecorder(::phsp_recorder, nvec,
+                      ::jparser-> GetStringValue("Recording/output"));
+  }
+  if ( ::dose_grid == nullptr ) return runaction;
+
+  runaction-> SetDoseGrid(::dose_grid, nvec, ::phantom-> GetNx(),
+                          ::phantom-> GetNy(), ::phantom-> GetNz());
+  if ( ::jparser-> Contains("Scoring/output") ) {
+    runaction-> SetDoseFile(::jparser-> GetStringValue("Scoring/output"));
+  }
+  runaction-> SetDoseSnapshot(::dose_snapshot);
+
+  if ( ::jparser-> Contains("Scoring/roi_min") &&
+       ::jparser-> Contains("Scoring/roi_max") ) {
+    std::vector<int> imin, imax;
+    ::jparser-> GetIntArray("Scoring/roi_min", imin);
+    ::jparser-> GetIntArray("Scoring/roi_max", imax);
+    runaction-> SetROI(imin, imax);
+  }
+  if ( ::jparser-> Contains("Scoring/roi_threshold") ) {
+    runaction->
+      SetROIThreshold(::jparser-> GetDoubleValue("Scoring/roi_threshold"));
+  }
+  return runaction;
+}
+
 } // end of namespace
 
 // ==========================================================================
@@ -159,12 +364,17 @@ AppBuilder::AppBuilder()
     bench_name_{""}, cpu_name_{""}
 {
   ::jparser = JsonParser::GetJsonParser();
+  ::appsetup = AppSetup::GetAppSetup();
 }
 
 // --------------------------------------------------------------------------
 AppBuilder::~AppBuilder()
 {
   delete [] simdata_;
+  delete ::dose_snapshot;
+  delete [] ::dose_grid;
+  delete ::phsp_file;
+  delete [] ::phsp_recorder;
 }
 
 // --------------------------------------------------------------------------
@@ -172,58 +382,139 @@ void AppBuilder::BuildApplication(int nthreads)
 {
   ::run_manager = G4RunManager::GetRunManager();
 
+  ::appsetup-> SetupRunMode();
+
+  ::appsetup-> SetupSeeding();
+
   nvec_ = nthreads;
 
   simdata_ = new SimData[nvec_];
+  ::appsetup-> SetupEventDigest(nvec_);
+  ::appsetup-> SetupEventCapture(nvec_);
+  ::appsetup-> SetupStepTable(nvec_);
+  ::appsetup-> StartProfiler();
+  ::appsetup-> StartTracer();
+  Tracer::GetTracer()-> Begin("initialize");
+
+  std::string scoring { "scalar" };
+  if ( ::jparser-> Contains("Scoring/type") ) {
+    scoring = ::jparser-> GetStringValue("Scoring/type");
+  }
+  if ( scoring == "dose" ) {
+    ::dose_grid = new DoseGrid[nvec_];
+    if ( ::jparser-> Contains("Scoring/snapshot_interval") ) {
+      auto interval = ::jparser-> GetDoubleValue("Scoring/snapshot_interval");
+      if ( interval > 0. ) {
+        ::dose_snapshot = new DoseSnapshot();
+        ::dose_snapshot-> SetInterval(interval);
+        if ( ::jparser-> Contains("Scoring/snapshot") ) {
+          ::dose_snapshot->
+            SetFileName(::jparser-> GetStringValue("Scoring/snapshot"));
+        }
+      }
+    }
+  } else if ( scoring != "scalar" ) {
+    std::cout << "[ ERROR ] AppBuilder::BuildApplication() "
+                 "invalid scoring type, " << scoring << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  BenchReport::GetBenchReport()-> SetString("scoring/type", scoring);
+
+  // phase-space recording at a plane
+  if ( ::jparser-> Contains("Recording/output") ) {
+    ::phsp_recorder = new PhspRecorder[nvec_];
+    if ( ::jparser-> Contains("Recording/buffer") ) {
+      auto nbuffer = ::jparser-> GetIntValue("Recording/buffer");
+      for ( int i = 0; i < nvec_; i++ ) {
+        ::phsp_recorder[i].SetBufferSize(nbuffer);
+      }
+    }
+  }
 
   ::SetupGeomtry(simdata_);
+  ::appsetup-> LoadEnergySpectrum("Primary/Beam/spectrum");
+  ::LoadPhaseSpace();
   ::run_manager-> SetUserInitialization(new QGSP_BIC);
   ::run_manager-> SetUserInitialization(this);
 
-  long seed { 0L };
-  if ( jparser-> Contains("Run/Seed") ) {
-    seed = jparser-> GetLongValue("Run/Seed");
+  if ( ::run_manager-> GetRunManagerType() != G4RunManager::sequentialRM ) {
+    auto worker_init = new WorkerInit();
+    worker_init-> SetSimData(simdata_);
+    ::run_manager-> SetUserInitialization(worker_init);
   }
 
-  G4Random::setTheSeed(seed);
+  ::appsetup-> SeedRandomEngine();
 
   ::run_manager-> Initialize();
+
+  Tracer::GetTracer()-> End();
 }
 
 // --------------------------------------------------------------------------
 void AppBuilder::Build() const
 {
-  auto pga = ::SetupPGA();
-  SetUserAction(pga);
+  if ( ::appsetup-> GetRunMode() == "navigator" ) {
+    SetUserAction(::SetupRayShooter(simdata_));
+  } else {
+    auto pga = ::SetupPGA(nvec_);
+    auto primary_action = new PrimaryAction(pga);
+    primary_action-> SetSimData(simdata_);
+    ::appsetup-> ConfigurePrimaryAction(primary_action);
+    SetUserAction(primary_action);
+  }
 
-  auto runaction = new RunAction();
+  auto runaction = ::CreateRunAction(nvec_);
   runaction-> SetSimData(simdata_);
   runaction-> SetDataSize(nvec_);
   runaction-> SetTestingFlag(qtest_);
   runaction-> SetBenchName(bench_name_);
   runaction-> SetCPUName(cpu_name_);
   runaction-> SetNThreads(nvec_);
+  ::appsetup-> ConfigureRunAction(runaction);
   SetUserAction(runaction);
 
   auto eventaction = new EventAction();
+  eventaction-> SetSimData(simdata_);
   eventaction-> SetCheckCounter(10000);
+  ::appsetup-> ConfigureEventAction(eventaction);
   SetUserAction(eventaction);
 
-  auto stepaction = new StepAction;
-  stepaction-> SetSimData(simdata_);
-  SetUserAction(stepaction);
+  auto stackaction = ::appsetup-> CreateStackAction(simdata_);
+  if ( stackaction != nullptr ) SetUserAction(stackaction);
+
+  if ( ::phsp_recorder != nullptr ) {
+    int tid = G4Threading::G4GetThreadId();
+    if ( tid == G4Threading::MASTER_ID ) tid = 0;
+
+    auto stepaction = new PlaneStepAction;
+    stepaction-> SetSimData(simdata_);
+    ::appsetup-> ConfigureStepAction(stepaction);
+    stepaction-> SetRecorder(&::phsp_recorder[tid]);
+    double zplane = 35. * cm;
+    if ( ::jparser-> Contains("Recording/plane") ) {
+      zplane = ::jparser-> GetDoubleValue("Recording/plane") * cm;
+    }
+    stepaction-> SetPlane(zplane);
+    SetUserAction(stepaction);
+  } else {
+    auto stepaction = new StepAction;
+    stepaction-> SetSimData(simdata_);
+    ::appsetup-> ConfigureStepAction(stepaction);
+    SetUserAction(stepaction);
+  }
 }
 
 // --------------------------------------------------------------------------
 void AppBuilder::BuildForMaster() const
 {
-  auto runaction = new RunAction();
+  auto runaction = ::CreateRunAction(nvec_);
   runaction-> SetSimData(simdata_);
   runaction-> SetDataSize(nvec_);
   runaction-> SetTestingFlag(qtest_);
   runaction-> SetBenchName(bench_name_);
   runaction-> SetCPUName(cpu_name_);
   runaction-> SetNThreads(nvec_);
+  ::appsetup-> ConfigureRunAction(runaction);
 
   SetUserAction(runaction);
 }
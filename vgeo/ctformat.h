@@ -0,0 +1,42 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef CT_FORMAT_H_
+#define CT_FORMAT_H_
+
+#include <cstdint>
+
+// binary layout of CT phantom files (native byte order)
+//
+//   CTHeader
+//   CTMaterial x nmat
+//   uint8_t material index x (nx * ny * nz), x runs fastest
+//
+namespace ctformat {
+
+constexpr char kMagic[8] = { 'G', '4', 'B', 'C', 'T', '0', '0', '1' };
+constexpr int kMaxMaterials = 256;
+constexpr int kMaterialNameLength = 32;
+
+struct CTHeader {
+  char magic[8];
+  uint32_t nx, ny, nz;
+  uint32_t nmat;
+  double dx, dy, dz;  // voxel size (mm)
+};
+
+struct CTMaterial {
+  char name[kMaterialNameLength];  // NIST material name
+  double density;  // g/cm3, zero for the NIST default
+};
+
+} // end of namespace
+
+#endif
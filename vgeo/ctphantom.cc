@@ -0,0 +1,148 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include "G4Material.hh"
+#include "G4NistManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "ctphantom.h"
+#include "ctformat.h"
+
+using namespace ctformat;
+
+// --------------------------------------------------------------------------
+CTPhantom::CTPhantom()
+  : nx_{0}, ny_{0}, nz_{0}, dx_{0.}, dy_{0.}, dz_{0.},
+    indices_{nullptr}
+{
+}
+
+// --------------------------------------------------------------------------
+void CTPhantom::SetHomogeneous(int nx, int ny, int nz,
+                               double dx, double dy, double dz)
+{
+  mfile_.Close();
+
+  nx_ = nx; ny_ = ny; nz_ = nz;
+  dx_ = dx; dy_ = dy; dz_ = dz;
+
+  mat_names_ = { "G4_WATER" };
+  mat_densities_ = { 0. };
+  materials_.clear();
+
+  homogeneous_.assign(GetNvoxels(), 0);
+  indices_ = homogeneous_.data();
+}
+
+// --------------------------------------------------------------------------
+bool CTPhantom::Load(const std::string& fname)
+{
+  if ( ! mfile_.Open(fname) ) {
+    std::cout << "[ ERROR ] CTPhantom::Load() cannot map a CT file, "
+              << fname << std::endl;
+    return false;
+  }
+
+  auto data = mfile_.GetData();
+  auto size = mfile_.GetSize();
+
+  CTHeader header;
+  if ( size < sizeof(header) ) {
+    std::cout << "[ ERROR ] CTPhantom::Load() truncated header, "
+              << fname << std::endl;
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+
+  if ( std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ) {
+    std::cout << "[ ERROR ] CTPhantom::Load() invalid file format, "
+              << fname << std::endl;
+    return false;
+  }
+
+  if ( header.nx == 0 || header.ny == 0 || header.nz == 0 ||
+       header.nmat == 0 || header.nmat > kMaxMaterials ) {
+    std::cout << "[ ERROR ] CTPhantom::Load() invalid dimensions, "
+              << fname << std::endl;
+    return false;
+  }
+
+  size_t nvoxels = size_t(header.nx) * header.ny * header.nz;
+  size_t offset = sizeof(header) + header.nmat * sizeof(CTMaterial);
+  if ( size != offset + nvoxels ) {
+    std::cout << "[ ERROR ] CTPhantom::Load() file size mismatch, "
+              << fname << std::endl;
+    return false;
+  }
+
+  mat_names_.clear();
+  mat_densities_.clear();
+  materials_.clear();
+  for ( uint32_t i = 0; i < header.nmat; i++ ) {
+    CTMaterial mat;
+    std::memcpy(&mat, data + sizeof(header) + i * sizeof(mat), sizeof(mat));
+    mat.name[kMaterialNameLength-1] = '\0';
+    mat_names_.push_back(mat.name);
+    mat_densities_.push_back(mat.density);
+  }
+
+  auto indices = reinterpret_cast<const uint8_t*>(data + offset);
+  for ( size_t i = 0; i < nvoxels; i++ ) {
+    if ( indices[i] >= header.nmat ) {
+      std::cout << "[ ERROR ] CTPhantom::Load() material index out of range, "
+                << fname << std::endl;
+      return false;
+    }
+  }
+
+  nx_ = header.nx; ny_ = header.ny; nz_ = header.nz;
+  dx_ = header.dx * mm; dy_ = header.dy * mm; dz_ = header.dz * mm;
+
+  homogeneous_.clear();
+  indices_ = indices;
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+const std::vector<G4Material*>& CTPhantom::BuildMaterials()
+{
+  if ( ! materials_.empty() ) return materials_;
+
+  auto nist_manager = G4NistManager::Instance();
+
+  for ( size_t i = 0; i < mat_names_.size(); i++ ) {
+    auto mat = nist_manager-> FindOrBuildMaterial(mat_names_[i]);
+    if ( mat == nullptr ) {
+      std::cout << "[ ERROR ] CTPhantom::BuildMaterials() "
+                   "unknown material, " << mat_names_[i] << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+
+    auto density = mat_densities_[i] * g/cm3;
+    if ( density > 0. &&
+         std::abs(density - mat-> GetDensity()) > 1.e-6 * g/cm3 ) {
+      std::stringstream ss;
+      ss << mat_names_[i] << "_" << mat_densities_[i];
+      mat = nist_manager-> FindOrBuildMaterial(ss.str());
+      if ( mat == nullptr ) {
+        mat = nist_manager-> BuildMaterialWithNewDensity(ss.str(),
+                                                         mat_names_[i],
+                                                         density);
+      }
+    }
+    materials_.push_back(mat);
+  }
+
+  return materials_;
+}
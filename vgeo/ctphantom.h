@@ -0,0 +1,107 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef CT_PHANTOM_H_
+#define CT_PHANTOM_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "util/mappedfile.h"
+
+class G4Material;
+
+// voxel material map, either homogeneous water or loaded from a CT file
+class CTPhantom {
+public:
+  CTPhantom();
+  ~CTPhantom() = default;
+
+  void SetHomogeneous(int nx, int ny, int nz,
+                      double dx, double dy, double dz);
+  bool Load(const std::string& fname);
+
+  int GetNx() const;
+  int GetNy() const;
+  int GetNz() const;
+  int GetNvoxels() const;
+  double GetDx() const;
+  double GetDy() const;
+  double GetDz() const;
+
+  const std::string& GetFileName() const;
+
+  // index array shared by all threads, x runs fastest
+  const uint8_t* GetMaterialIndices() const;
+
+  // build G4 materials, the vector is indexed by material index
+  const std::vector<G4Material*>& BuildMaterials();
+
+private:
+  int nx_, ny_, nz_;
+  double dx_, dy_, dz_;
+
+  std::vector<std::string> mat_names_;
+  std::vector<double> mat_densities_;
+  std::vector<G4Material*> materials_;
+
+  kut::MappedFile mfile_;
+  std::vector<uint8_t> homogeneous_;
+  const uint8_t* indices_;
+
+};
+
+// ==========================================================================
+inline int CTPhantom::GetNx() const
+{
+  return nx_;
+}
+
+inline int CTPhantom::GetNy() const
+{
+  return ny_;
+}
+
+inline int CTPhantom::GetNz() const
+{
+  return nz_;
+}
+
+inline int CTPhantom::GetNvoxels() const
+{
+  return nx_ * ny_ * nz_;
+}
+
+inline double CTPhantom::GetDx() const
+{
+  return dx_;
+}
+
+inline double CTPhantom::GetDy() const
+{
+  return dy_;
+}
+
+inline double CTPhantom::GetDz() const
+{
+  return dz_;
+}
+
+inline const std::string& CTPhantom::GetFileName() const
+{
+  return mfile_.GetFileName();
+}
+
+inline const uint8_t* CTPhantom::GetMaterialIndices() const
+{
+  return indices_;
+}
+
+#endif
@@ -0,0 +1,202 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <cstdlib>
+#include <cstring>
+#include "dosegrid.h"
+
+// --------------------------------------------------------------------------
+namespace {
+
+const std::size_t kCacheLine = 64;
+
+double* AllocateArray(int n)
+{
+  // padded to a whole number of cache lines
+  std::size_t size = n * sizeof(double);
+  size = ( size + kCacheLine - 1 ) / kCacheLine * kCacheLine;
+  auto ptr = static_cast<double*>(std::aligned_alloc(kCacheLine, size));
+  std::memset(ptr, 0, size);
+  return ptr;
+}
+
+} // end of namespace
+
+// ==========================================================================
+std::atomic<int> DoseGrid::epoch_request_ {0};
+std::mutex DoseGrid::ack_mutex_;
+std::condition_variable DoseGrid::ack_cv_;
+long DoseGrid::nacks_ {0};
+
+// --------------------------------------------------------------------------
+DoseGrid::DoseGrid()
+  : nvoxels_{0}, bank_{{nullptr, nullptr, 0}, {nullptr, nullptr, 0}},
+    active_{0}, history_{nullptr}, epoch_{0}, retired_{1}, acked_epoch_{0},
+    finished_{false}
+{
+}
+
+// --------------------------------------------------------------------------
+DoseGrid::~DoseGrid()
+{
+  for ( auto& bank : bank_ ) {
+    std::free(bank.sum);
+    std::free(bank.sum2);
+  }
+  std::free(history_);
+}
+
+// --------------------------------------------------------------------------
+void DoseGrid::Allocate(int nvoxels)
+{
+  if ( nvoxels == nvoxels_ ) return;
+
+  for ( auto& bank : bank_ ) {
+    std::free(bank.sum);
+    std::free(bank.sum2);
+    bank.sum = ::AllocateArray(nvoxels);
+    bank.sum2 = ::AllocateArray(nvoxels);
+    bank.nhistories = 0;
+  }
+  std::free(history_);
+  history_ = ::AllocateArray(nvoxels);
+
+  nvoxels_ = nvoxels;
+  touched_.clear();
+  touched_.reserve(1024);
+  Reset();
+}
+
+// --------------------------------------------------------------------------
+void DoseGrid::Reset()
+{
+  if ( nvoxels_ == 0 ) return;
+
+  for ( auto& bank : bank_ ) {
+    std::memset(bank.sum, 0, nvoxels_ * sizeof(double));
+    std::memset(bank.sum2, 0, nvoxels_ * sizeof(double));
+    bank.nhistories = 0;
+  }
+  std::memset(history_, 0, nvoxels_ * sizeof(double));
+  touched_.clear();
+
+  active_ = 0;
+  retired_ = 1;
+  epoch_ = epoch_request_.load(std::memory_order_acquire);
+  acked_epoch_.store(epoch_, std::memory_order_release);
+  finished_.store(false, std::memory_order_release);
+}
+
+// --------------------------------------------------------------------------
+void DoseGrid::EndOfHistory()
+{
+  auto& bank = bank_[active_];
+  for ( auto index : touched_ ) {
+    auto edep = history_[index];
+    bank.sum[index] += edep;
+    bank.sum2[index] += edep * edep;
+    history_[index] = 0.;
+  }
+  touched_.clear();
+  bank.nhistories++;
+
+  // one acquire load per history,
+  // nothing on the step path
+  auto epoch = epoch_request_.load(std::memory_order_acquire);
+  if ( epoch != epoch_ ) SwitchBank(epoch);
+}
+
+// --------------------------------------------------------------------------
+void DoseGrid::SwitchBank(int epoch)
+{
+  // the bank to be activated has been merged and cleared by the writer
+  // before the request was released
+  retired_ = active_;
+  active_ = 1 - active_;
+  epoch_ = epoch;
+
+  acked_epoch_.store(epoch, std::memory_order_release);
+  NotifyAck();
+}
+
+// --------------------------------------------------------------------------
+void DoseGrid::Finish()
+{
+  // both banks are left to the writer from here on
+  finished_.store(true, std::memory_order_release);
+  NotifyAck();
+}
+
+// --------------------------------------------------------------------------
+void DoseGrid::RequestEpoch(int epoch)
+{
+  epoch_request_.store(epoch, std::memory_order_release);
+}
+
+// --------------------------------------------------------------------------
+void DoseGrid::NotifyAck()
+{
+  // once per epoch and thread, never on the step path
+  {
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    nacks_++;
+  }
+  ack_cv_.notify_all();
+}
+
+// --------------------------------------------------------------------------
+long DoseGrid::GetAckCount()
+{
+  std::lock_guard<std::mutex> lock(ack_mutex_);
+  return nacks_;
+}
+
+// --------------------------------------------------------------------------
+void DoseGrid::WaitForAck(long count)
+{
+  std::unique_lock<std::mutex> lock(ack_mutex_);
+  ack_cv_.wait(lock, [count]{ return nacks_ != count; });
+}
+
+// --------------------------------------------------------------------------
+bool DoseGrid::MergeRetired(int epoch, double* sum, double* sum2, long& nhist)
+{
+  if ( finished_.load(std::memory_order_acquire) ) {
+    for ( auto& bank : bank_ ) MergeBank(bank, sum, sum2, nhist);
+    return true;
+  }
+
+  if ( acked_epoch_.load(std::memory_order_acquire) != epoch ) return false;
+
+  MergeBank(bank_[retired_], sum, sum2, nhist);
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void DoseGrid::MergeBank(Bank& bank, double* sum, double* sum2,
+                         long& nhist)
+{
+  if ( bank.nhistories == 0 ) return;
+
+  for ( int i = 0; i < nvoxels_; i++ ) {
+    sum[i] += bank.sum[i];
+    sum2[i] += bank.sum2[i];
+  }
+  std::memset(bank.sum, 0, nvoxels_ * sizeof(double));
+  std::memset(bank.sum2, 0, nvoxels_ * sizeof(double));
+  nhist += bank.nhistories;
+  bank.nhistories = 0;
+}
+
+// --------------------------------------------------------------------------
+std::size_t DoseGrid::GetMemorySize() const
+{
+  return 5 * nvoxels_ * sizeof(double) + touched_.capacity() * sizeof(int);
+}
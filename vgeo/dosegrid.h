@@ -0,0 +1,118 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef DOSE_GRID_H_
+#define DOSE_GRID_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// thread-local dense edep tally with per-history statistics,
+// aligned to cache lines so that threads never share a line.
+//
+// sum/sum2 are double-banked for live snapshots: when a new epoch is
+// requested, the owning thread switches banks at the end of a history
+// and the retired bank can be merged by another thread. A grid whose
+// thread has finished the run counts as acknowledged for every epoch.
+class alignas(64) DoseGrid {
+public:
+  DoseGrid();
+  ~DoseGrid();
+
+  DoseGrid(const DoseGrid&) = delete;
+  DoseGrid& operator=(const DoseGrid&) = delete;
+
+  // allocated by the owning thread (first touch)
+  void Allocate(int nvoxels);
+  void Reset();
+
+  void AddEdep(int index, double edep);
+
+  // fold the current history into sum/sum2
+  void EndOfHistory();
+
+  // no more histories from the owning thread in this run
+  void Finish();
+
+  int GetNvoxels() const;
+  long GetNhistories() const;
+  const double* GetSum(int bank) const;
+  const double* GetSum2(int bank) const;
+  std::size_t GetMemorySize() const;
+
+  // snapshot (called from the writer thread)
+  static void RequestEpoch(int epoch);
+  bool MergeRetired(int epoch, double* sum, double* sum2, long& nhist);
+
+  // number of acknowledgements so far, and wait for one more
+  static long GetAckCount();
+  static void WaitForAck(long count);
+
+private:
+  struct Bank {
+    double* sum;
+    double* sum2;
+    long nhistories;
+  };
+
+  int nvoxels_;
+  Bank bank_[2];
+  int active_;
+  double* history_;
+  std::vector<int> touched_;
+
+  int epoch_;
+  int retired_;
+  std::atomic<int> acked_epoch_;
+  std::atomic<bool> finished_;
+
+  static std::atomic<int> epoch_request_;
+  static std::mutex ack_mutex_;
+  static std::condition_variable ack_cv_;
+  static long nacks_;
+
+  void SwitchBank(int epoch);
+  void MergeBank(Bank& bank, double* sum, double* sum2, long& nhist);
+  static void NotifyAck();
+
+};
+
+// ==========================================================================
+inline void DoseGrid::AddEdep(int index, double edep)
+{
+  if ( edep <= 0. ) return;
+  if ( history_[index] == 0. ) touched_.push_back(index);
+  history_[index] += edep;
+}
+
+inline int DoseGrid::GetNvoxels() const
+{
+  return nvoxels_;
+}
+
+inline long DoseGrid::GetNhistories() const
+{
+  return bank_[0].nhistories + bank_[1].nhistories;
+}
+
+inline const double* DoseGrid::GetSum(int bank) const
+{
+  return bank_[bank].sum;
+}
+
+inline const double* DoseGrid::GetSum2(int bank) const
+{
+  return bank_[bank].sum2;
+}
+
+#endif
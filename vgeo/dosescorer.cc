@@ -0,0 +1,85 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include "G4Step.hh"
+#include "G4Threading.hh"
+#include "G4VTouchable.hh"
+#include "dosegrid.h"
+#include "dosescorer.h"
+#include "common/simdata.h"
+
+// --------------------------------------------------------------------------
+namespace {
+
+inline int GetThreadIndex()
+{
+  auto tid = G4Threading::G4GetThreadId();
+
+  if ( tid == G4Threading::MASTER_ID) {
+    tid = 0;
+  }
+
+  return tid;
+}
+
+} // end of namespace
+
+// ==========================================================================
+DoseScorer::DoseScorer()
+: G4VSensitiveDetector("dosescorer"), simdata_{nullptr},
+  dose_grid_{nullptr}, nx_{0}, ny_{0}, regular_{false}
+{
+}
+
+// --------------------------------------------------------------------------
+void DoseScorer::SetDoseGrid(DoseGrid* grid, int nx, int ny, int nz,
+                             bool regular)
+{
+  // grid of this thread, allocated here in the owning thread
+  dose_grid_ = &grid[::GetThreadIndex()];
+  dose_grid_-> Allocate(nx * ny * nz);
+
+  nx_ = nx;
+  ny_ = ny;
+  regular_ = regular;
+}
+
+// --------------------------------------------------------------------------
+bool DoseScorer::ProcessHits(G4Step* step, G4TouchableHistory*)
+{
+  // weighted phase-space particles, secondaries inherit the weight.
+  // history sums of the grid are weighted the same way
+  auto edep = step-> GetTotalEnergyDeposit() *
+              step-> GetPreStepPoint()-> GetWeight();
+  simdata_[::GetThreadIndex()].AddEdep(edep);
+
+  // a step stays in one voxel, equal materials are not skipped
+  // in the regular layout when dose is scored
+  auto touchable = step-> GetPreStepPoint()-> GetTouchable();
+  int index = 0;
+  if ( regular_ ) {
+    index = touchable-> GetReplicaNumber(0);
+  } else {
+    auto ix = touchable-> GetReplicaNumber(0);
+    auto iy = touchable-> GetReplicaNumber(1);
+    auto iz = touchable-> GetReplicaNumber(2);
+    index = ix + nx_ * ( iy + ny_ * iz );
+  }
+
+  dose_grid_-> AddEdep(index, edep);
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void DoseScorer::EndOfEvent(G4HCofThisEvent*)
+{
+  dose_grid_-> EndOfHistory();
+}
@@ -0,0 +1,49 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef DOSE_SCORER_H_
+#define DOSE_SCORER_H_
+
+#include "G4VSensitiveDetector.hh"
+
+class DoseGrid;
+class G4HCofThisEvent;
+class G4Step;
+class SimData;
+
+class DoseScorer : public G4VSensitiveDetector {
+public:
+  DoseScorer();
+  ~DoseScorer() override = default;
+
+  bool ProcessHits(G4Step* step, G4TouchableHistory*) override;
+  void EndOfEvent(G4HCofThisEvent*) override;
+
+  void SetSimData(SimData* data);
+
+  // voxel index from copy numbers of the regular structure, or
+  // from (x param., y replica, z replica) of the nested layout
+  void SetDoseGrid(DoseGrid* grid, int nx, int ny, int nz, bool regular);
+
+private:
+  SimData* simdata_;
+  DoseGrid* dose_grid_;
+  int nx_, ny_;
+  bool regular_;
+
+};
+
+// ==========================================================================
+inline void DoseScorer::SetSimData(SimData* data)
+{
+  simdata_ = data;
+}
+
+#endif
@@ -0,0 +1,162 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include "dosegrid.h"
+#include "dosesnapshot.h"
+
+// ==========================================================================
+DoseSnapshot::DoseSnapshot()
+  : dose_grid_{nullptr}, ngrids_{0}, nx_{0}, ny_{0}, nz_{0},
+    fname_{"dose_snapshot.bin"}, interval_{60.},
+    nhistories_{0}, epoch_{0}, nsnapshots_{0}, write_time_{0.},
+    qstop_{false}
+{
+}
+
+// --------------------------------------------------------------------------
+DoseSnapshot::~DoseSnapshot()
+{
+  Stop();
+}
+
+// --------------------------------------------------------------------------
+void DoseSnapshot::Start()
+{
+  Stop();
+
+  sum_.assign(nx_ * ny_ * nz_, 0.);
+  sum2_.assign(nx_ * ny_ * nz_, 0.);
+  nhistories_ = 0;
+  nsnapshots_ = 0;
+  write_time_ = 0.;
+  qstop_ = false;
+
+  thread_ = std::thread(&DoseSnapshot::Loop, this);
+}
+
+// --------------------------------------------------------------------------
+void DoseSnapshot::Stop()
+{
+  if ( ! thread_.joinable() ) return;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    qstop_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+}
+
+// --------------------------------------------------------------------------
+void DoseSnapshot::Loop()
+{
+  auto period = std::chrono::duration<double>(interval_);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while ( ! cv_.wait_for(lock, period, [this]{ return qstop_; }) ) {
+    lock.unlock();
+    TakeSnapshot();
+    lock.lock();
+  }
+}
+
+// --------------------------------------------------------------------------
+void DoseSnapshot::TakeSnapshot()
+{
+  auto t0 = std::chrono::steady_clock::now();
+
+  // ask every thread to switch banks at its next end of history
+  epoch_++;
+  DoseGrid::RequestEpoch(epoch_);
+
+  // merge retired banks as they come. a busy thread acknowledges at its
+  // next end of history, a thread done with the run at once
+  std::vector<bool> pending(ngrids_, false);
+  int npending = 0;
+  for ( int i = 0; i < ngrids_; i++ ) {
+    if ( dose_grid_[i].GetNvoxels() == int(sum_.size()) ) {
+      pending[i] = true;
+      npending++;
+    }
+  }
+
+  int nmerged = 0;
+  while ( npending > 0 ) {
+    auto nacks = DoseGrid::GetAckCount();
+    for ( int i = 0; i < ngrids_; i++ ) {
+      if ( pending[i] &&
+           dose_grid_[i].MergeRetired(epoch_, sum_.data(), sum2_.data(),
+                                      nhistories_) ) {
+        pending[i] = false;
+        npending--;
+        nmerged++;
+      }
+    }
+    if ( npending > 0 ) DoseGrid::WaitForAck(nacks);
+  }
+
+  // written aside and renamed, readers never see a partial file
+  auto tmpname = fname_ + ".tmp";
+  if ( WriteDoseFile(tmpname, nx_, ny_, nz_, nhistories_,
+                     sum_.data(), sum2_.data()) ) {
+    std::rename(tmpname.c_str(), fname_.c_str());
+    nsnapshots_++;
+  } else {
+    std::cout << "[ WARNING ] DoseSnapshot::TakeSnapshot() "
+                 "cannot write a snapshot, " << fname_ << std::endl;
+  }
+
+  auto t1 = std::chrono::steady_clock::now();
+  write_time_ += std::chrono::duration<double>(t1 - t0).count();
+
+  std::cout << "[ MESSAGE ] dose snapshot #" << epoch_ << " : "
+            << nhistories_ << " histories (" << nmerged << "/" << ngrids_
+            << " threads)" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+bool DoseSnapshot::WriteDoseFile(const std::string& fname,
+                                 int nx, int ny, int nz, long nhistories,
+                                 const double* sum, const double* sum2)
+{
+  std::ofstream ofs(fname, std::ios::binary);
+  if ( ! ofs ) return false;
+
+  const char magic[8] = { 'G', '4', 'B', 'D', 'O', 'S', 'E', '1' };
+  int32_t dims[3] = { nx, ny, nz };
+  int64_t nhist = nhistories;
+  ofs.write(magic, sizeof(magic));
+  ofs.write(reinterpret_cast<const char*>(dims), sizeof(dims));
+  ofs.write(reinterpret_cast<const char*>(&nhist), sizeof(nhist));
+
+  const std::size_t nvoxels = std::size_t(nx) * ny * nz;
+  std::vector<double> mean(nvoxels, 0.), error(nvoxels, 0.);
+  if ( nhistories > 1 ) {
+    double n = nhistories;
+    for ( std::size_t i = 0; i < nvoxels; i++ ) {
+      mean[i] = sum[i] / n;
+      double var = ( sum2[i] / n - mean[i] * mean[i] ) / (n - 1.);
+      error[i] = std::sqrt(std::max(var, 0.));
+    }
+  }
+  ofs.write(reinterpret_cast<const char*>(mean.data()),
+            nvoxels * sizeof(double));
+  ofs.write(reinterpret_cast<const char*>(error.data()),
+            nvoxels * sizeof(double));
+
+  return ofs.good();
+}
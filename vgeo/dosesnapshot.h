@@ -0,0 +1,122 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef DOSE_SNAPSHOT_H_
+#define DOSE_SNAPSHOT_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class DoseGrid;
+
+// background writer of periodic dose snapshots during a run
+class DoseSnapshot {
+public:
+  DoseSnapshot();
+  ~DoseSnapshot();
+
+  DoseSnapshot(const DoseSnapshot&) = delete;
+  DoseSnapshot& operator=(const DoseSnapshot&) = delete;
+
+  void SetDoseGrid(DoseGrid* grid, int ngrids, int nx, int ny, int nz);
+  void SetFileName(const std::string& fname);
+  void SetInterval(double sec);
+
+  void Start();
+  void Stop();
+
+  // dose merged by snapshots so far, valid after Stop()
+  const std::vector<double>& GetSum() const;
+  const std::vector<double>& GetSum2() const;
+  long GetNhistories() const;
+
+  int GetNsnapshots() const;
+  double GetWriteTime() const;
+
+  // binary dose file : header (magic, nx/ny/nz, #histories), then mean
+  // edep per history and its standard error (MeV), x runs fastest
+  static bool WriteDoseFile(const std::string& fname,
+                            int nx, int ny, int nz, long nhistories,
+                            const double* sum, const double* sum2);
+
+private:
+  DoseGrid* dose_grid_;
+  int ngrids_;
+  int nx_, ny_, nz_;
+  std::string fname_;
+  double interval_;
+
+  std::vector<double> sum_;
+  std::vector<double> sum2_;
+  long nhistories_;
+  int epoch_;
+  int nsnapshots_;
+  double write_time_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool qstop_;
+
+  void Loop();
+  void TakeSnapshot();
+
+};
+
+// ==========================================================================
+inline void DoseSnapshot::SetDoseGrid(DoseGrid* grid, int ngrids,
+                                      int nx, int ny, int nz)
+{
+  dose_grid_ = grid;
+  ngrids_ = ngrids;
+  nx_ = nx;
+  ny_ = ny;
+  nz_ = nz;
+}
+
+inline void DoseSnapshot::SetFileName(const std::string& fname)
+{
+  fname_ = fname;
+}
+
+inline void DoseSnapshot::SetInterval(double sec)
+{
+  interval_ = sec;
+}
+
+inline const std::vector<double>& DoseSnapshot::GetSum() const
+{
+  return sum_;
+}
+
+inline const std::vector<double>& DoseSnapshot::GetSum2() const
+{
+  return sum2_;
+}
+
+inline long DoseSnapshot::GetNhistories() const
+{
+  return nhistories_;
+}
+
+inline int DoseSnapshot::GetNsnapshots() const
+{
+  return nsnapshots_;
+}
+
+inline double DoseSnapshot::GetWriteTime() const
+{
+  return write_time_;
+}
+
+#endif
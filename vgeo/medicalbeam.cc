@@ -14,6 +14,7 @@ See the License for more information.
 #include "G4Event.hh"
 #include "G4Electron.hh"
 #include "G4Gamma.hh"
+#include "G4Geantino.hh"
 #include "G4PrimaryVertex.hh"
 #include "G4Proton.hh"
 #include "G4PhysicalConstants.hh"
@@ -21,6 +22,7 @@ See the License for more information.
 #include "G4ThreeVector.hh"
 #include "Randomize.hh"
 #include "medicalbeam.h"
+#include "common/energyspectrum.h"
 
 namespace {
 
@@ -28,25 +30,26 @@ namespace {
 enum { k6MV = 6, k18MV = 18 };
 
 // --------------------------------------------------------------------------
-G4ThreeVector GenerateBeamDirection(double ssd, double fxy)
+G4ThreeVector GenerateBeamDirection(double ssd, double fxy,
+                                    double u1, double u2)
 {
-  const double dr = std::sqrt(2.) * fxy / 2.;
-  const double R = std::sqrt(sqr(ssd)+sqr(dr));
-  const double cos0 = ssd/R;
-
-  const double xymax = fxy/ssd/2.;
-  double dx, dy, dz, dsin, dphi;
-
-  do {
-    dz = G4RandFlat::shoot(cos0, 1.);
-    dsin = std::sqrt(1.-sqr(dz));
-    dphi = G4RandFlat::shoot(0., twopi);
-
-    dx = dsin * std::cos(dphi);
-    dy = dsin * std::sin(dphi);
-  } while(! (std::abs(dx) < xymax*dz && std::abs(dy) < xymax*dz) );
-
-  return G4ThreeVector(dx,dy,dz);
+  // direction uniform in solid angle over the square field, sampled by
+  // inverting the exact CDFs (no rejection). (x, y) on the plane z = 1,
+  // dOmega = dx dy / (1 + x^2 + y^2)^(3/2), |x|, |y| < a.
+  const double a = fxy/ssd/2.;
+  const double b = 1. + a*a;
+
+  // x : F(x) ~ atan(a x / sqrt(b + x^2))
+  const double t_max = std::atan(a*a / std::sqrt(1. + 2.*a*a));
+  const double t = std::tan((2.*u1 - 1.) * t_max);
+  const double x = t * std::sqrt(b) / std::sqrt(a*a - t*t);
+
+  // y given x : G(y) ~ y / sqrt(c^2 + y^2), c^2 = 1 + x^2
+  const double c2 = 1. + x*x;
+  const double g = (2.*u2 - 1.) * a / std::sqrt(c2 + a*a);
+  const double y = g * std::sqrt(c2) / std::sqrt(1. - g*g);
+
+  return G4ThreeVector(x, y, 1.).unit();
 }
 
 // --------------------------------------------------------------------------
@@ -82,65 +85,81 @@ G4ThreeVector GenerateBeamDirection(double ssd, double fxy)
     1.3752E-07, 6.5072E-08, 6.5072E-13
   };
 
-  std::vector<double> vec_energy6(kSize6), vec_cprob6(kSize6);
-  std::vector<double> vec_energy18(kSize18), vec_cprob18(kSize18);
-
 // --------------------------------------------------------------------------
-void InitializePhotnSpectrum()
+EnergySpectrum* BuildLinacSpectrum(const double* rprob, int size)
 {
-  for ( int i = 0; i < kSize6; i++ ) {
-    vec_energy6[i] = kEbin * i;
-    if ( i == 0 ) vec_cprob6[i] = 0.;
-    else vec_cprob6[i] = vec_cprob6[i-1] + vec_rprob6[i];
+  // rprob[i] is the weight of [kEbin*(i-1), kEbin*i)
+  std::vector<double> elow, width, weight;
+  for ( int i = 1; i < size; i++ ) {
+    elow.push_back(kEbin * (i-1));
+    width.push_back(kEbin);
+    weight.push_back(rprob[i]);
   }
 
-  for ( int i = 0; i < kSize18; i++ ) {
-    vec_energy18[i] = kEbin * i;
-    if ( i == 0 ) vec_cprob18[i] = 0.;
-    else vec_cprob18[i] = vec_cprob18[i-1] + vec_rprob18[i];
-  }
+  auto spectrum = new EnergySpectrum();
+  spectrum-> SetBins(elow, width, weight);
+  return spectrum;
 }
 
 // --------------------------------------------------------------------------
-double GeneratePhotonEnergy6MV()
+const EnergySpectrum* GetLinacSpectrum(int volt)
 {
-  auto rand_max = vec_cprob6[kSize6-1];
-  auto psampled = G4RandFlat::shoot(0., rand_max);
-  auto low = std::lower_bound( vec_cprob6.begin(),
-                               vec_cprob6.end(), psampled );
-
-  auto idx = low - vec_cprob6.begin();
-  auto rpos = ( psampled - vec_cprob6[idx-1] ) /
-              ( vec_cprob6[idx] - vec_cprob6[idx-1] );
-  auto egen = vec_energy6[idx-1] + kEbin * rpos;
+  // built once on first use, thread-safe static initialization
+  static const EnergySpectrum* spectrum6 =
+    BuildLinacSpectrum(vec_rprob6, kSize6);
+  static const EnergySpectrum* spectrum18 =
+    BuildLinacSpectrum(vec_rprob18, kSize18);
 
-  return egen;
+  return volt == k18MV ? spectrum18 : spectrum6;
 }
 
+} // end of namespace
+
 // --------------------------------------------------------------------------
-double GeneratePhotonEnergy18MV()
+MedicalBeam::MedicalBeam()
+  : particle_type_(kElectron), kinetic_energy_(20.*MeV),
+    photon_voltage_(::k6MV), spectrum_(nullptr),
+    ssd_(100.*cm), field_xy_(10.*cm), batch_size_(0), cursor_(0)
 {
-  auto rand_max = vec_cprob18[kSize18-1];
-  auto psampled = G4RandFlat::shoot(0., rand_max);
-  auto low = std::lower_bound( vec_cprob18.begin(),
-                               vec_cprob18.end(), psampled );
-
-  auto idx = low - vec_cprob18.begin();
-  auto rpos = ( psampled - vec_cprob18[idx-1] ) /
-              ( vec_cprob18[idx] - vec_cprob18[idx-1] );
-  auto egen = vec_energy18[idx-1] + kEbin * rpos;
-
-  return egen;
 }
 
-} // end of namespace
+// --------------------------------------------------------------------------
+void MedicalBeam::SetBatchSize(int n)
+{
+  batch_size_ = std::max(n, 0);
+  cursor_ = batch_size_;  // filled on the next event
+
+  buf_energy_.resize(batch_size_);
+  buf_dx_.resize(batch_size_);
+  buf_dy_.resize(batch_size_);
+  buf_dz_.resize(batch_size_);
+  buf_rand_.resize(4 * batch_size_);
+}
 
 // --------------------------------------------------------------------------
-MedicalBeam::MedicalBeam()
-  : particle_type_(kElectron), kinetic_energy_(20.*MeV),
-    photon_voltage_(::k6MV), ssd_(100.*cm), field_xy_(10.*cm)
+void MedicalBeam::FillBatch()
 {
-  ::InitializePhotnSpectrum();
+  // one flat array from the engine, then SoA loops per quantity
+  const int n = batch_size_;
+  G4Random::getTheEngine()-> flatArray(4*n, buf_rand_.data());
+  const double* u = buf_rand_.data();
+
+  for ( int i = 0; i < n; i++ ) {
+    auto dir = ::GenerateBeamDirection(ssd_, field_xy_, u[i], u[n+i]);
+    buf_dx_[i] = dir.x();
+    buf_dy_[i] = dir.y();
+    buf_dz_[i] = dir.z();
+  }
+
+  if ( particle_type_ == kPhoton ) {
+    for ( int i = 0; i < n; i++ ) {
+      buf_energy_[i] = spectrum_-> Sample(u[2*n+i], u[3*n+i]);
+    }
+  } else {
+    std::fill(buf_energy_.begin(), buf_energy_.end(), kinetic_energy_);
+  }
+
+  cursor_ = 0;
 }
 
 // --------------------------------------------------------------------------
@@ -154,6 +173,7 @@ void MedicalBeam::SetPhotonVoltage(int volt)
   }
 
   photon_voltage_ = volt;
+  spectrum_ = ::GetLinacSpectrum(volt);
 }
 
 // --------------------------------------------------------------------------
@@ -170,29 +190,39 @@ void MedicalBeam::GeneratePrimaries(G4Event* event)
     case kPhoton :
       particle = G4Gamma::Gamma();
       break;
+    case kGeantino :
+      particle = G4Geantino::Geantino();
+      break;
     default :
       particle = G4Electron::Electron();
       break;
   }
 
+  if ( particle_type_ == kPhoton && spectrum_ == nullptr ) {
+    spectrum_ = ::GetLinacSpectrum(photon_voltage_);
+  }
+
+  double energy = kinetic_energy_;
+  G4ThreeVector dir;
+  if ( batch_size_ > 0 ) {
+    if ( cursor_ >= batch_size_ ) FillBatch();
+    energy = buf_energy_[cursor_];
+    dir.set(buf_dx_[cursor_], buf_dy_[cursor_], buf_dz_[cursor_]);
+    cursor_++;
+  } else {
+    if ( particle_type_ == kPhoton ) energy = spectrum_-> Sample();
+    auto u1 = G4UniformRand();
+    auto u2 = G4UniformRand();
+    dir = ::GenerateBeamDirection(ssd_, field_xy_, u1, u2);
+  }
+
   G4ThreeVector pvec;
   if ( particle_type_ == kPhoton ) {
-    double energy;
-    if ( photon_voltage_ == ::k6MV )
-      energy = ::GeneratePhotonEnergy6MV();
-    else if ( photon_voltage_ == ::k18MV )
-      energy = ::GeneratePhotonEnergy18MV();
-    else {
-      std::cout << "[ ERROR ] MedicalBeam::GeneratePrimaries() "
-                   "phton voltage should be 6 or 8 MV, "
-                << photon_voltage_ << std::endl;
-      std::exit(EXIT_FAILURE);
-    }
-    pvec = energy * ::GenerateBeamDirection(ssd_, field_xy_);
+    pvec = energy * dir;
   } else {
     auto mass = particle-> GetPDGMass();
-    auto momemtum = std::sqrt(sqr(mass+kinetic_energy_) - sqr(mass));
-    pvec = momemtum * ::GenerateBeamDirection(ssd_, field_xy_);
+    auto momemtum = std::sqrt(sqr(mass+energy) - sqr(mass));
+    pvec = momemtum * dir;
   }
 
   auto primary = new G4PrimaryParticle(particle,
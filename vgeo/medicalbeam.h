@@ -11,9 +11,11 @@ See the License for more information.
 #ifndef MEDICAL_BEAM_H
 #define MEDICAL_BEAM_H
 
+#include <vector>
 #include "G4VUserPrimaryGeneratorAction.hh"
 
 class G4ParticleDefinition;
+class EnergySpectrum;
 
 class MedicalBeam : public G4VUserPrimaryGeneratorAction {
 public:
@@ -23,7 +25,7 @@ public:
   MedicalBeam(const MedicalBeam&) = delete;
   void operator=(const MedicalBeam&) = delete;
 
-  enum { kElectron = 0, kPhoton, kProton};
+  enum { kElectron = 0, kPhoton, kProton, kGeantino };
 
   void SetParticle(int ptype);
   int GetParticle() const;
@@ -35,21 +37,38 @@ public:
   void SetPhotonVoltage(int volt);
   int GetPhotonVoltage() const;
 
+  // arbitrary photon spectrum, shared among threads (not owned)
+  void SetSpectrum(const EnergySpectrum* spectrum);
+
   void SetSSD(double val_ssd);
   double GetSSD() const;
 
   void SetFieldSize(double val_xy);
   double GetFieldSize() const;
 
+  // pre-generate energies/directions in blocks of n primaries (0 = off)
+  void SetBatchSize(int n);
+  int GetBatchSize() const;
+
   void GeneratePrimaries(G4Event* event) override;
 
 private:
   int particle_type_;
   double kinetic_energy_;
   int photon_voltage_;
+  const EnergySpectrum* spectrum_;
 
   double ssd_;
   double field_xy_;
+
+  // batched primaries (SoA), per-thread as the beam itself
+  int batch_size_;
+  int cursor_;
+  std::vector<double> buf_energy_;
+  std::vector<double> buf_dx_, buf_dy_, buf_dz_;
+  std::vector<double> buf_rand_;
+
+  void FillBatch();
 };
 
 // ====================================================================
@@ -78,6 +97,11 @@ inline int MedicalBeam::GetPhotonVoltage() const
   return photon_voltage_;
 }
 
+inline void MedicalBeam::SetSpectrum(const EnergySpectrum* spectrum)
+{
+  spectrum_ = spectrum;
+}
+
 inline void MedicalBeam::SetSSD(double val_ssd)
 {
   ssd_ = val_ssd;
@@ -98,4 +122,9 @@ inline double MedicalBeam::GetFieldSize() const
   return field_xy_;
 }
 
+inline int MedicalBeam::GetBatchSize() const
+{
+  return batch_size_;
+}
+
 #endif
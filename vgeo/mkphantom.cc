@@ -0,0 +1,158 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <getopt.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ctformat.h"
+
+using namespace ctformat;
+
+namespace {
+// --------------------------------------------------------------------------
+void show_help()
+{
+  const char* message =
+R"(
+usage:
+mkphantom [options] output
+
+   -h, --help              show this message.
+   -n, --voxels=NX,NY,NZ   set number of voxels [61,61,150]
+   -d, --size=DX,DY,DZ     set voxel size in mm [5,5,2]
+)";
+
+   std::cout << message << std::endl;
+}
+
+// --------------------------------------------------------------------------
+enum { kAir = 0, kTissue, kLung, kBone };
+
+void set_material(CTMaterial& mat, const char* name, double density)
+{
+  std::memset(&mat, 0, sizeof(mat));
+  std::strncpy(mat.name, name, kMaterialNameLength-1);
+  mat.density = density;
+}
+
+// synthetic torso : elliptic body with two lungs and a spine
+uint8_t tissue_at(double x, double y, double z)
+{
+  auto in_ellipse = [](double x, double y, double x0, double y0,
+                       double a, double b) {
+    double u = (x - x0) / a, v = (y - y0) / b;
+    return u*u + v*v <= 1.;
+  };
+
+  if ( ! in_ellipse(x, y, 0., 0., 0.45, 0.35) ) return kAir;
+  if ( in_ellipse(x, y, 0., -0.22, 0.06, 0.06) ) return kBone;
+  if ( z > 0.2 && z < 0.7 ) {
+    if ( in_ellipse(x, y, -0.2, 0.02, 0.12, 0.2) ||
+         in_ellipse(x, y,  0.2, 0.02, 0.12, 0.2) ) return kLung;
+  }
+  return kTissue;
+}
+
+} // end of namespace
+
+// --------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  uint32_t nx = 61, ny = 61, nz = 150;
+  double dx = 5., dy = 5., dz = 2.;
+
+  struct option long_options[] = {
+    {"help",    no_argument,        0 ,  'h'},
+    {"voxels",  required_argument,  0 ,  'n'},
+    {"size",    required_argument,  0 ,  'd'},
+    {0,         0,                  0,    0}
+  };
+
+  while (1) {
+    int option_index = -1;
+
+    int c = getopt_long(argc, argv, "hn:d:", long_options, &option_index);
+
+    if (c == -1) break;
+
+    switch (c) {
+    case 'h' :
+      show_help();
+      std::exit(EXIT_SUCCESS);
+    case 'n' :
+      if ( std::sscanf(optarg, "%u,%u,%u", &nx, &ny, &nz) != 3 ) {
+        show_help();
+        std::exit(EXIT_FAILURE);
+      }
+      break;
+    case 'd' :
+      if ( std::sscanf(optarg, "%lf,%lf,%lf", &dx, &dy, &dz) != 3 ) {
+        show_help();
+        std::exit(EXIT_FAILURE);
+      }
+      break;
+    default:
+      show_help();
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if ( optind != argc - 1 || nx == 0 || ny == 0 || nz == 0 ) {
+    show_help();
+    std::exit(EXIT_FAILURE);
+  }
+
+  CTHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.nx = nx; header.ny = ny; header.nz = nz;
+  header.dx = dx; header.dy = dy; header.dz = dz;
+
+  std::vector<CTMaterial> materials(4);
+  set_material(materials[kAir], "G4_AIR", 0.);
+  set_material(materials[kTissue], "G4_WATER", 0.);
+  set_material(materials[kLung], "G4_LUNG_ICRP", 0.26);
+  set_material(materials[kBone], "G4_BONE_CORTICAL_ICRP", 0.);
+  header.nmat = materials.size();
+
+  // x runs fastest, coordinates normalized to [-0.5, 0.5] (x/y), [0,1] (z)
+  std::vector<uint8_t> indices(size_t(nx) * ny * nz);
+  size_t index = 0;
+  for ( uint32_t iz = 0; iz < nz; iz++ ) {
+    double z = (iz + 0.5) / nz;
+    for ( uint32_t iy = 0; iy < ny; iy++ ) {
+      double y = (iy + 0.5) / ny - 0.5;
+      for ( uint32_t ix = 0; ix < nx; ix++ ) {
+        double x = (ix + 0.5) / nx - 0.5;
+        indices[index++] = ::tissue_at(x, y, z);
+      }
+    }
+  }
+
+  std::ofstream ofs(argv[optind], std::ios::binary);
+  if ( ! ofs ) {
+    std::cout << "[ ERROR ] cannot open an output file, "
+              << argv[optind] << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  ofs.write(reinterpret_cast<const char*>(materials.data()),
+            materials.size() * sizeof(CTMaterial));
+  ofs.write(reinterpret_cast<const char*>(indices.data()), indices.size());
+
+  std::cout << "[ MESSAGE ] " << argv[optind] << " : "
+            << nx << "x" << ny << "x" << nz << " voxels ("
+            << dx << "x" << dy << "x" << dz << " mm)" << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <getopt.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "phspformat.h"
+
+using namespace phspformat;
+
+namespace {
+// --------------------------------------------------------------------------
+void show_help()
+{
+  const char* message =
+R"(
+usage:
+mkphsp [options] output
+
+   -h, --help              show this message.
+   -n, --particles=N       set number of particles [1000000]
+   -e, --energy=E          set end-point energy in MeV [6]
+   -f, --field=F           set field size at SSD in cm [10]
+   -s, --ssd=SSD           set source-to-surface distance in cm [100]
+   -z, --plane=Z           set z of the scoring plane in cm [30]
+   -r, --seed=SEED         set random seed [1]
+)";
+
+   std::cout << message << std::endl;
+}
+
+// phantom front surface in vgeo (cm)
+const double kZsurface = 35.;
+
+} // end of namespace
+
+// --------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  uint64_t nparticles = 1000000;
+  double e0 = 6., field = 10., ssd = 100., zplane = 30.;
+  unsigned long seed = 1;
+
+  struct option long_options[] = {
+    {"help",       no_argument,        0 ,  'h'},
+    {"particles",  required_argument,  0 ,  'n'},
+    {"energy",     required_argument,  0 ,  'e'},
+    {"field",      required_argument,  0 ,  'f'},
+    {"ssd",        required_argument,  0 ,  's'},
+    {"plane",      required_argument,  0 ,  'z'},
+    {"seed",       required_argument,  0 ,  'r'},
+    {0,            0,                  0,    0}
+  };
+
+  while (1) {
+    int option_index = -1;
+
+    int c = getopt_long(argc, argv, "hn:e:f:s:z:r:",
+                        long_options, &option_index);
+
+    if (c == -1) break;
+
+    switch (c) {
+    case 'h' :
+      show_help();
+      std::exit(EXIT_SUCCESS);
+    case 'n' :
+      nparticles = std::stoull(optarg);
+      break;
+    case 'e' :
+      e0 = std::stod(optarg);
+      break;
+    case 'f' :
+      field = std::stod(optarg);
+      break;
+    case 's' :
+      ssd = std::stod(optarg);
+      break;
+    case 'z' :
+      zplane = std::stod(optarg);
+      break;
+    case 'r' :
+      seed = std::stoul(optarg);
+      break;
+    default:
+      show_help();
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  const double zsource = kZsurface - ssd;
+  if ( optind != argc - 1 || nparticles == 0 || e0 <= 0.1 ||
+       field <= 0. || zplane <= zsource ) {
+    show_help();
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::ofstream ofs(argv[optind], std::ios::binary);
+  if ( ! ofs ) {
+    std::cout << "[ ERROR ] cannot open an output file, "
+              << argv[optind] << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  PhspHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.nparticles = nparticles;
+  ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  // photons from a point source into a square field, projected onto
+  // the scoring plane. energies follow a Kramers thick-target spectrum,
+  // dN/dE ~ (E0 - E) / E, above 0.1 MeV.
+  std::mt19937_64 engine(seed);
+  std::uniform_real_distribution<double> flat(0., 1.);
+
+  const double emin = 0.1;
+  const double half_tan = field / ssd / 2.;
+  const double dzplane = zplane - zsource;
+
+  std::vector<PhspRecord> buffer;
+  buffer.reserve(65536);
+
+  for ( uint64_t i = 0; i < nparticles; i++ ) {
+    double ekin;
+    do {
+      ekin = emin * std::pow(e0 / emin, flat(engine));  // ~ 1/E
+    } while ( flat(engine) > (e0 - ekin) / (e0 - emin) );
+
+    double tx = (2. * flat(engine) - 1.) * half_tan;
+    double ty = (2. * flat(engine) - 1.) * half_tan;
+    double norm = std::sqrt(1. + tx*tx + ty*ty);
+
+    PhspRecord record;
+    record.pdg = 22;
+    record.energy = ekin;
+    record.x = tx * dzplane * 10.;
+    record.y = ty * dzplane * 10.;
+    record.z = zplane * 10.;
+    record.dx = tx / norm;
+    record.dy = ty / norm;
+    record.dz = 1. / norm;
+    record.weight = 1.;
+    buffer.push_back(record);
+
+    if ( buffer.size() == buffer.capacity() || i == nparticles - 1 ) {
+      ofs.write(reinterpret_cast<const char*>(buffer.data()),
+                buffer.size() * sizeof(PhspRecord));
+      buffer.clear();
+    }
+  }
+
+  std::cout << "[ MESSAGE ] " << argv[optind] << " : "
+            << nparticles << " photons (" << e0 << " MeV, "
+            << field << "x" << field << " cm2 at SSD " << ssd << " cm)"
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
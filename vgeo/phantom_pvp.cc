@@ -14,18 +14,12 @@ See the License for more information.
 #include "G4VTouchable.hh"
 #include "phantom_pvp.h"
 
-namespace {
-
-G4Material* water = nullptr;
-
-} // end of namespace
-
 // --------------------------------------------------------------------------
 PhantomPVP::PhantomPVP()
-  : nx_{0}, dx_{0.}
+  : nx_{0}, dx_{0.}, ny_{0}, indices_{nullptr}
 {
   auto nist_manager = G4NistManager::Instance();
-  ::water = nist_manager-> FindOrBuildMaterial("G4_WATER");
+  materials_.push_back(nist_manager-> FindOrBuildMaterial("G4_WATER"));
 }
 
 // --------------------------------------------------------------------------
@@ -33,19 +27,26 @@ G4Material* PhantomPVP::ComputeMaterial(G4VPhysicalVolume* physvol,
                                         const int idx,
                                         const G4VTouchable* parent)
 {
-  return ::water;
+  if ( indices_ == nullptr || parent == nullptr ) return materials_[0];
+
+  // parent touchable : depth 0 = y replica, depth 1 = z replica
+  auto iy = parent-> GetReplicaNumber(0);
+  auto iz = parent-> GetReplicaNumber(1);
+  auto index = idx + nx_ * ( iy + ny_ * iz );
+
+  return materials_[indices_[index]];
 }
 
 // --------------------------------------------------------------------------
 int PhantomPVP::GetNumberOfMaterials() const
 {
-  return 1;
+  return materials_.size();
 }
 
 // --------------------------------------------------------------------------
 G4Material* PhantomPVP::GetMaterial(int idx) const
 {
-  return ::water;
+  return materials_[idx];
 }
 
 // --------------------------------------------------------------------------
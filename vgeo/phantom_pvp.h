@@ -11,6 +11,8 @@ See the License for more information.
 #ifndef PHANTOM_PVP_H_
 #define PHANTOM_PVP_H_
 
+#include <cstdint>
+#include <vector>
 #include "G4VNestedParameterisation.hh"
 
 class G4Material;
@@ -34,9 +36,16 @@ public:
 
   void SetSegment(int n, double dx);
 
+  // material map indexed by ix + nx * (iy + ny * iz)
+  void SetMaterialMap(const std::vector<G4Material*>& materials,
+                      const uint8_t* indices, int ny);
+
 private:
   int nx_;
   double dx_;
+  int ny_;
+  std::vector<G4Material*> materials_;
+  const uint8_t* indices_;
 
 };
 
@@ -47,4 +56,13 @@ inline void PhantomPVP::SetSegment(int n, double dx)
   dx_ = dx;
 }
 
+inline void PhantomPVP::SetMaterialMap(
+                        const std::vector<G4Material*>& materials,
+                        const uint8_t* indices, int ny)
+{
+  materials_ = materials;
+  indices_ = indices;
+  ny_ = ny;
+}
+
 #endif
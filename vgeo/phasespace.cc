@@ -0,0 +1,142 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "G4Event.hh"
+#include "G4ParticleTable.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ThreeVector.hh"
+#include "Randomize.hh"
+#include "phasespace.h"
+
+using namespace phspformat;
+
+// --------------------------------------------------------------------------
+bool PhaseSpaceFile::Open(const std::string& fname)
+{
+  if ( ! mfile_.Open(fname) ) {
+    std::cout << "[ ERROR ] PhaseSpaceFile::Open() cannot map a phase-space "
+                 "file, " << fname << std::endl;
+    return false;
+  }
+
+  auto data = mfile_.GetData();
+  auto size = mfile_.GetSize();
+
+  PhspHeader header;
+  if ( size < sizeof(header) ) {
+    std::cout << "[ ERROR ] PhaseSpaceFile::Open() truncated header, "
+              << fname << std::endl;
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+
+  if ( std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ) {
+    std::cout << "[ ERROR ] PhaseSpaceFile::Open() invalid file format, "
+              << fname << std::endl;
+    return false;
+  }
+
+  if ( header.nparticles == 0 ||
+       size != sizeof(header) + header.nparticles * sizeof(PhspRecord) ) {
+    std::cout << "[ ERROR ] PhaseSpaceFile::Open() file size mismatch, "
+              << fname << std::endl;
+    return false;
+  }
+
+  nparticles_ = header.nparticles;
+  records_ = reinterpret_cast<const PhspRecord*>(data + sizeof(header));
+
+  return true;
+}
+
+// ==========================================================================
+PhaseSpaceSource::PhaseSpaceSource(const PhaseSpaceFile* file,
+                                   int offset, int nstride)
+  : file_{file}, offset_{0}, nstride_{1}, index_{0},
+    recycle_{1}, nused_{0}, rotate_{false}, qevent_index_{false},
+    npasses_{0}
+{
+  nstride_ = std::max(nstride, 1);
+  offset_ = std::max(offset, 0) % nstride_;
+
+  // with fewer particles than threads, fall back to a shared start
+  if ( offset_ >= file_-> GetNparticles() ) offset_ %= file_-> GetNparticles();
+  index_ = offset_;
+}
+
+// --------------------------------------------------------------------------
+G4ParticleDefinition* PhaseSpaceSource::FindParticle(int pdg)
+{
+  auto itr = particle_cache_.find(pdg);
+  if ( itr != particle_cache_.end() ) return itr-> second;
+
+  auto particle = G4ParticleTable::GetParticleTable()-> FindParticle(pdg);
+  if ( particle == nullptr ) {
+    std::cout << "[ ERROR ] PhaseSpaceSource::FindParticle() "
+                 "unknown PDG code, " << pdg << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  particle_cache_[pdg] = particle;
+
+  return particle;
+}
+
+// --------------------------------------------------------------------------
+void PhaseSpaceSource::GeneratePrimaries(G4Event* event)
+{
+  if ( qevent_index_ ) {
+    uint64_t id = event-> GetEventID();
+    index_ = ( id / recycle_ ) % file_-> GetNparticles();
+    nused_ = id % recycle_;
+  }
+
+  const PhspRecord& record = file_-> GetRecords()[index_];
+
+  G4ThreeVector position(record.x * mm, record.y * mm, record.z * mm);
+  G4ThreeVector direction(record.dx, record.dy, record.dz);
+
+  // recycled particles are rotated around the beam axis
+  if ( rotate_ && nused_ > 0 ) {
+    double phi = twopi * G4UniformRand();
+    position.rotateZ(phi);
+    direction.rotateZ(phi);
+  }
+
+  auto primary = new G4PrimaryParticle(FindParticle(record.pdg));
+  primary-> SetKineticEnergy(record.energy * MeV);
+  primary-> SetMomentumDirection(direction.unit());
+
+  auto vertex = new G4PrimaryVertex(position, 0.);
+  vertex-> SetWeight(record.weight);
+  vertex-> SetPrimary(primary);
+  event-> AddPrimaryVertex(vertex);
+
+  // advance to the next particle of this stride
+  if ( qevent_index_ ) return;
+  if ( ++nused_ < recycle_ ) return;
+  nused_ = 0;
+  index_ += nstride_;
+
+  if ( index_ >= file_-> GetNparticles() ) {
+    index_ = offset_;
+    npasses_++;
+    if ( npasses_ == 1 ) {
+      std::cout << "[ WARNING ] PhaseSpaceSource::GeneratePrimaries() "
+                   "phase-space file exhausted, restarting from the top, "
+                << file_-> GetFileName() << std::endl;
+    }
+  }
+}
@@ -0,0 +1,105 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef PHASE_SPACE_H_
+#define PHASE_SPACE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include "G4VUserPrimaryGeneratorAction.hh"
+#include "util/mappedfile.h"
+#include "phspformat.h"
+
+class G4ParticleDefinition;
+
+// memory mapped phase-space file, opened once and shared read-only
+class PhaseSpaceFile {
+public:
+  PhaseSpaceFile() = default;
+  ~PhaseSpaceFile() = default;
+
+  bool Open(const std::string& fname);
+
+  uint64_t GetNparticles() const;
+  const phspformat::PhspRecord* GetRecords() const;
+  const std::string& GetFileName() const;
+
+private:
+  kut::MappedFile mfile_;
+  uint64_t nparticles_ {0};
+  const phspformat::PhspRecord* records_ {nullptr};
+
+};
+
+// primary generator reading every nstride-th particle from an offset,
+// so that threads read disjoint records without locking
+class PhaseSpaceSource : public G4VUserPrimaryGeneratorAction {
+public:
+  PhaseSpaceSource(const PhaseSpaceFile* file, int offset, int nstride);
+  ~PhaseSpaceSource() override = default;
+
+  PhaseSpaceSource(const PhaseSpaceSource&) = delete;
+  void operator=(const PhaseSpaceSource&) = delete;
+
+  // each particle is used n times, rotated randomly around z if set
+  void SetRecycle(int n, bool rotate);
+
+  // particles picked by event ID instead of the thread stride
+  void SetEventIndexing(bool val);
+
+  void GeneratePrimaries(G4Event* event) override;
+
+private:
+  const PhaseSpaceFile* file_;
+  uint64_t offset_;
+  uint64_t nstride_;
+  uint64_t index_;
+  int recycle_;
+  int nused_;
+  bool rotate_;
+  bool qevent_index_;
+  long npasses_;
+
+  std::map<int, G4ParticleDefinition*> particle_cache_;
+
+  G4ParticleDefinition* FindParticle(int pdg);
+
+};
+
+// ==========================================================================
+inline uint64_t PhaseSpaceFile::GetNparticles() const
+{
+  return nparticles_;
+}
+
+inline const phspformat::PhspRecord* PhaseSpaceFile::GetRecords() const
+{
+  return records_;
+}
+
+inline const std::string& PhaseSpaceFile::GetFileName() const
+{
+  return mfile_.GetFileName();
+}
+
+inline void PhaseSpaceSource::SetRecycle(int n, bool rotate)
+{
+  recycle_ = std::max(n, 1);
+  rotate_ = rotate;
+}
+
+inline void PhaseSpaceSource::SetEventIndexing(bool val)
+{
+  qevent_index_ = val;
+}
+
+#endif
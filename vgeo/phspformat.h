@@ -0,0 +1,43 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef PHSP_FORMAT_H_
+#define PHSP_FORMAT_H_
+
+#include <cstdint>
+
+// binary layout of phase-space files (native byte order)
+//
+//   PhspHeader
+//   PhspRecord x nparticles
+//
+namespace phspformat {
+
+constexpr char kMagic[8] = { 'G', '4', 'B', 'P', 'H', 'S', 'P', '1' };
+
+struct PhspHeader {
+  char magic[8];
+  uint64_t nparticles;
+};
+
+struct PhspRecord {
+  int32_t pdg;  // PDG encoding
+  float energy;  // kinetic energy (MeV)
+  float x, y, z;  // position (mm)
+  float dx, dy, dz;  // direction
+  float weight;
+};
+
+static_assert(sizeof(PhspHeader) == 16, "unexpected header padding");
+static_assert(sizeof(PhspRecord) == 36, "unexpected record padding");
+
+} // end of namespace
+
+#endif
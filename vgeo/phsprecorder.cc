@@ -0,0 +1,202 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include "phsprecorder.h"
+
+using namespace phspformat;
+
+// --------------------------------------------------------------------------
+namespace {
+
+// chunk size for merging part files
+const std::size_t kCopyBlock = 1 << 20;
+
+} // end of namespace
+
+// ==========================================================================
+PhspRecorder::PhspRecorder()
+  : buffer_size_{16384}, active_{0}, nfill_{0}, nrecords_{0},
+    stall_time_{0.}, pending_bank_{0}, npending_{0}, qpending_{false},
+    qstop_{false}, write_time_{0.}
+{
+}
+
+// --------------------------------------------------------------------------
+PhspRecorder::~PhspRecorder()
+{
+  Close();
+}
+
+// --------------------------------------------------------------------------
+bool PhspRecorder::Open(const std::string& fname)
+{
+  Close();
+
+  fname_ = fname;
+  ofs_.open(fname_, std::ios::binary | std::ios::trunc);
+  if ( ! ofs_ ) {
+    std::cout << "[ ERROR ] PhspRecorder::Open() cannot open a file, "
+              << fname_ << std::endl;
+    return false;
+  }
+
+  bank_[0].resize(buffer_size_);
+  bank_[1].resize(buffer_size_);
+  active_ = 0;
+  nfill_ = 0;
+  nrecords_ = 0;
+  stall_time_ = 0.;
+  pending_bank_ = 0;
+  npending_ = 0;
+  qpending_ = false;
+  qstop_ = false;
+  write_time_ = 0.;
+
+  thread_ = std::thread(&PhspRecorder::Loop, this);
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void PhspRecorder::Close()
+{
+  if ( ! thread_.joinable() ) return;
+
+  if ( nfill_ > 0 ) Flush();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    qstop_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+
+  ofs_.close();
+}
+
+// --------------------------------------------------------------------------
+void PhspRecorder::Flush()
+{
+  // hand the active bank to the writer, waiting only if the writer is
+  // still busy with the other one
+  std::unique_lock<std::mutex> lock(mutex_);
+  if ( qpending_ ) {
+    auto t0 = std::chrono::steady_clock::now();
+    cv_.wait(lock, [this]{ return ! qpending_; });
+    auto t1 = std::chrono::steady_clock::now();
+    stall_time_ += std::chrono::duration<double>(t1 - t0).count();
+  }
+
+  pending_bank_ = active_;
+  npending_ = nfill_;
+  qpending_ = true;
+  lock.unlock();
+  cv_.notify_all();
+
+  nrecords_ += nfill_;
+  active_ ^= 1;
+  nfill_ = 0;
+}
+
+// --------------------------------------------------------------------------
+void PhspRecorder::Loop()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while ( true ) {
+    cv_.wait(lock, [this]{ return qpending_ || qstop_; });
+    if ( ! qpending_ ) break;
+
+    // the filling thread owns the other bank, write without the lock
+    const auto& bank = bank_[pending_bank_];
+    auto n = npending_;
+    lock.unlock();
+
+    auto t0 = std::chrono::steady_clock::now();
+    ofs_.write(reinterpret_cast<const char*>(bank.data()),
+               n * sizeof(PhspRecord));
+    auto t1 = std::chrono::steady_clock::now();
+
+    lock.lock();
+    write_time_ += std::chrono::duration<double>(t1 - t0).count();
+    qpending_ = false;
+    cv_.notify_all();
+  }
+}
+
+// --------------------------------------------------------------------------
+bool PhspRecorder::Merge(const std::string& fname,
+                         const std::vector<std::string>& parts,
+                         uint64_t nparticles)
+{
+  std::ofstream ofs(fname, std::ios::binary | std::ios::trunc);
+  if ( ! ofs ) {
+    std::cout << "[ ERROR ] PhspRecorder::Merge() cannot open a file, "
+              << fname << std::endl;
+  } else {
+    PhspHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.nparticles = nparticles;
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+
+  // a part is removed only once it is in the output,
+  // everything else is left on disk and reported
+  bool qok = ofs.good();
+  std::vector<char> block(::kCopyBlock);
+  for ( const auto& part : parts ) {
+    if ( ! qok ) {
+      std::cout << "[ ERROR ] PhspRecorder::Merge() part file kept, "
+                << part << std::endl;
+      continue;
+    }
+
+    std::ifstream ifs(part, std::ios::binary);
+    if ( ! ifs ) {
+      std::cout << "[ ERROR ] PhspRecorder::Merge() cannot open a part file, "
+                << part << std::endl;
+      qok = false;
+      continue;
+    }
+    while ( ifs && ofs ) {
+      ifs.read(block.data(), block.size());
+      ofs.write(block.data(), ifs.gcount());
+    }
+
+    ofs.flush();
+
+    if ( ifs.bad() || ! ifs.eof() ) {
+      std::cout << "[ ERROR ] PhspRecorder::Merge() cannot read a part file, "
+                << part << std::endl;
+      qok = false;
+    } else if ( ! ofs.good() ) {
+      std::cout << "[ ERROR ] PhspRecorder::Merge() cannot write a file, "
+                << fname << ", part file kept, " << part << std::endl;
+      qok = false;
+    } else {
+      ifs.close();
+      std::remove(part.c_str());
+    }
+  }
+
+  if ( qok ) {
+    ofs.close();
+    qok = ofs.good();
+    if ( ! qok ) {
+      std::cout << "[ ERROR ] PhspRecorder::Merge() cannot close a file, "
+                << fname << std::endl;
+    }
+  }
+
+  return qok;
+}
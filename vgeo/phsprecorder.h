@@ -0,0 +1,110 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef PHSP_RECORDER_H_
+#define PHSP_RECORDER_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "phspformat.h"
+
+// per-thread phase-space writer. records are filled into one bank while
+// a background thread writes the other to a part file (records only).
+class PhspRecorder {
+public:
+  PhspRecorder();
+  ~PhspRecorder();
+
+  PhspRecorder(const PhspRecorder&) = delete;
+  PhspRecorder& operator=(const PhspRecorder&) = delete;
+
+  void SetBufferSize(std::size_t n);
+
+  bool Open(const std::string& fname);
+  void Close();
+
+  void Record(const phspformat::PhspRecord& record);
+
+  uint64_t GetNrecords() const;
+  double GetWriteTime() const;
+  double GetStallTime() const;
+  const std::string& GetFileName() const;
+
+  // concatenate part files into a phase-space file and remove them.
+  // on failure, parts not yet merged are left on disk and reported
+  static bool Merge(const std::string& fname,
+                    const std::vector<std::string>& parts,
+                    uint64_t nparticles);
+
+private:
+  std::string fname_;
+  std::ofstream ofs_;
+  std::size_t buffer_size_;
+
+  std::vector<phspformat::PhspRecord> bank_[2];
+  int active_;
+  std::size_t nfill_;
+  uint64_t nrecords_;
+  double stall_time_;
+
+  // writer thread, guarded by mutex_
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int pending_bank_;
+  std::size_t npending_;
+  bool qpending_;
+  bool qstop_;
+  double write_time_;
+
+  void Flush();
+  void Loop();
+
+};
+
+// ==========================================================================
+inline void PhspRecorder::SetBufferSize(std::size_t n)
+{
+  buffer_size_ = std::max<std::size_t>(n, 1);
+}
+
+inline void PhspRecorder::Record(const phspformat::PhspRecord& record)
+{
+  bank_[active_][nfill_++] = record;
+  if ( nfill_ == buffer_size_ ) Flush();
+}
+
+inline uint64_t PhspRecorder::GetNrecords() const
+{
+  return nrecords_;
+}
+
+inline double PhspRecorder::GetWriteTime() const
+{
+  return write_time_;
+}
+
+inline double PhspRecorder::GetStallTime() const
+{
+  return stall_time_;
+}
+
+inline const std::string& PhspRecorder::GetFileName() const
+{
+  return fname_;
+}
+
+#endif
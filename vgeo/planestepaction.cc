@@ -0,0 +1,55 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include "phsprecorder.h"
+#include "planestepaction.h"
+
+// --------------------------------------------------------------------------
+PlaneStepAction::PlaneStepAction()
+  : zplane_{0.}, recorder_{nullptr}
+{
+}
+
+// --------------------------------------------------------------------------
+void PlaneStepAction::UserSteppingAction(const G4Step* step)
+{
+  StepAction::UserSteppingAction(step);
+
+  // a step ending on a boundary at the plane counts once, on arrival
+  const auto& pos0 = step-> GetPreStepPoint()-> GetPosition();
+  const auto& pos1 = step-> GetPostStepPoint()-> GetPosition();
+  if ( (pos0.z() < zplane_) == (pos1.z() < zplane_) ) return;
+
+  auto track = step-> GetTrack();
+  auto pdg = track-> GetDefinition()-> GetPDGEncoding();
+  if ( pdg == 0 ) return;
+
+  // crossing point on the straight step
+  double t = (zplane_ - pos0.z()) / (pos1.z() - pos0.z());
+  auto pos = pos0 + t * (pos1 - pos0);
+  auto post = step-> GetPostStepPoint();
+  const auto& dir = post-> GetMomentumDirection();
+
+  phspformat::PhspRecord record;
+  record.pdg = pdg;
+  record.energy = post-> GetKineticEnergy() / MeV;
+  record.x = pos.x() / mm;
+  record.y = pos.y() / mm;
+  record.z = zplane_ / mm;
+  record.dx = dir.x();
+  record.dy = dir.y();
+  record.dz = dir.z();
+  record.weight = track-> GetWeight();
+
+  recorder_-> Record(record);
+}
@@ -0,0 +1,46 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef PLANE_STEP_ACTION_H_
+#define PLANE_STEP_ACTION_H_
+
+#include "common/stepaction.h"
+
+class PhspRecorder;
+
+// step action recording particles crossing a plane z = const
+class PlaneStepAction : public StepAction {
+public:
+  PlaneStepAction();
+  ~PlaneStepAction() override = default;
+
+  void SetPlane(double z);
+  void SetRecorder(PhspRecorder* recorder);
+
+  void UserSteppingAction(const G4Step* step) override;
+
+private:
+  double zplane_;
+  PhspRecorder* recorder_;
+
+};
+
+// ==========================================================================
+inline void PlaneStepAction::SetPlane(double z)
+{
+  zplane_ = z;
+}
+
+inline void PlaneStepAction::SetRecorder(PhspRecorder* recorder)
+{
+  recorder_ = recorder;
+}
+
+#endif
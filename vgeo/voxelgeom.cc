@@ -8,17 +8,39 @@ This software is distributed WITHOUT ANY WARRANTY; without even the
 implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
 See the License for more information.
 ============================================================================*/
+#include <vector>
 #include "G4Box.hh"
 #include "G4LogicalVolume.hh"
 #include "G4NistManager.hh"
+#include "G4PhantomParameterisation.hh"
 #include "G4PVParameterised.hh"
 #include "G4PVPlacement.hh"
 #include "G4PVReplica.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4VisAttributes.hh"
 #include "voxelgeom.h"
+#include "ctphantom.h"
+#include "dosescorer.h"
 #include "phantom_pvp.h"
 #include "common/calscorer.h"
+#include "util/benchreport.h"
+
+using namespace kut;
+
+// --------------------------------------------------------------------------
+namespace {
+
+// phantom surface, beam SSD is measured from here
+const double kZ_PhantomSurface = 35.*cm;
+
+const char* kLayoutName[] = { "nested", "regular" };
+
+} // end of namespace
+
+// --------------------------------------------------------------------------
+VoxelGeom::~VoxelGeom()
+{
+}
 
 // --------------------------------------------------------------------------
 G4VPhysicalVolume* VoxelGeom::Construct()
@@ -35,70 +57,175 @@ G4VPhysicalVolume* VoxelGeom::Construct()
   auto world_pv = new G4PVPlacement(nullptr, G4ThreeVector(), "world",
                                              world_lv, nullptr, false, 0);
 
-  // phantom
-  const double kDXY_Phantom = 30.5*cm;
-  const double kDZ_Phantom = 30.*cm;
-  const double kZ_Phantom = 50.*cm;
+  // default, 61x61x150 water voxels
+  if ( phantom_ == nullptr ) {
+    phantom_.reset(new CTPhantom());
+    phantom_-> SetHomogeneous(61, 61, 150, 5.*mm, 5.*mm, 2.*mm);
+  }
 
-  auto phantom_box = new G4Box("phantom", kDXY_Phantom/2., kDXY_Phantom/2.,
+  // phantom
+  const double kDX_Phantom = phantom_-> GetNx() * phantom_-> GetDx();
+  const double kDY_Phantom = phantom_-> GetNy() * phantom_-> GetDy();
+  const double kDZ_Phantom = phantom_-> GetNz() * phantom_-> GetDz();
+  const double kZ_Phantom = kZ_PhantomSurface + kDZ_Phantom/2.;
+
+  if ( kDX_Phantom > kDXY_World || kDY_Phantom > kDXY_World ||
+       kZ_Phantom + kDZ_Phantom/2. > kDZ_World/2. ) {
+    std::cout << "[ ERROR ] VoxelGeom::Construct() "
+                 "phantom does not fit in the world." << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  auto phantom_box = new G4Box("phantom", kDX_Phantom/2., kDY_Phantom/2.,
                                           kDZ_Phantom/2.);
   auto water = nist_manager-> FindOrBuildMaterial("G4_WATER");
   auto phantom_lv = new G4LogicalVolume(phantom_box, water, "phantom");
   auto phantom = new G4PVPlacement(0, G4ThreeVector(0., 0., kZ_Phantom),
                                    phantom_lv, "phantom", world_lv, false, 0);
 
-  // voxel params.
-  const int kNxy_Voxel = 61;
-  const int kNz_Voxel = 150;
-  const double kDXY_Voxel = 5. * mm;
-  const double kDZ_Voxel = 2. * mm;
+  if ( layout_ == kRegular ) {
+    ConstructRegular(phantom);
+  } else {
+    ConstructNested(phantom_lv);
+  }
+
+  auto nmat = phantom_-> BuildMaterials().size();
+
+  std::cout << "[ MESSAGE ] phantom layout : "
+            << ::kLayoutName[layout_] << ", "
+            << phantom_-> GetNx() << "x" << phantom_-> GetNy() << "x"
+            << phantom_-> GetNz() << " voxels, "
+            << nmat << " material(s)" << std::endl;
+
+  auto report = BenchReport::GetBenchReport();
+  report-> SetString("geometry/layout", ::kLayoutName[layout_]);
+  report-> SetLong("geometry/voxels", phantom_-> GetNvoxels());
+  report-> SetLong("geometry/materials", nmat);
+  if ( layout_ == kRegular ) {
+    report-> SetBool("geometry/skip_equal_materials", dose_grid_ == nullptr);
+  }
+  if ( phantom_-> GetFileName() != "" ) {
+    report-> SetString("geometry/ct_file", phantom_-> GetFileName());
+  }
+
+  // vis attributes
+  auto va = new G4VisAttributes(G4Color(1.,1.,1.));
+  va-> SetVisibility(true);
+  world_lv-> SetVisAttributes(va);
+
+  va = new G4VisAttributes();
+  va-> SetVisibility(false);
+  phantom_lv-> SetVisAttributes(va);
+
+  return world_pv;
+}
+
+// --------------------------------------------------------------------------
+void VoxelGeom::ConstructNested(G4LogicalVolume* phantom_lv)
+{
+  auto water = G4NistManager::Instance()-> FindOrBuildMaterial("G4_WATER");
+
+  const int kNx_Voxel = phantom_-> GetNx();
+  const int kNy_Voxel = phantom_-> GetNy();
+  const int kNz_Voxel = phantom_-> GetNz();
+  const double kDX_Voxel = phantom_-> GetDx();
+  const double kDY_Voxel = phantom_-> GetDy();
+  const double kDZ_Voxel = phantom_-> GetDz();
 
   // 1st, replication along z-axis
-  auto voxel_dz_solid = new G4Box("vz", kDXY_Phantom/2.,
-                                        kDXY_Phantom/2., kDZ_Voxel/2.);
+  auto voxel_dz_solid = new G4Box("vz", kNx_Voxel*kDX_Voxel/2.,
+                                  kNy_Voxel*kDY_Voxel/2., kDZ_Voxel/2.);
   auto voxel_dz_lv = new G4LogicalVolume(voxel_dz_solid, water, "vz");
   auto voxel_dz = new G4PVReplica("vz", voxel_dz_lv, phantom_lv,
                                   kZAxis, kNz_Voxel, kDZ_Voxel);
 
   // 2nd, replication along y-axis
-  auto voxel_dyz_solid = new G4Box("vyz", kDXY_Phantom/2.,
-                                          kDXY_Voxel/2., kDZ_Voxel/2.);
+  auto voxel_dyz_solid = new G4Box("vyz", kNx_Voxel*kDX_Voxel/2.,
+                                          kDY_Voxel/2., kDZ_Voxel/2.);
   auto voxel_dyz_lv = new G4LogicalVolume(voxel_dyz_solid, water, "vyz");
   auto phantom_dyz = new G4PVReplica("vyz", voxel_dyz_lv, voxel_dz_lv,
-                                     kYAxis, kNxy_Voxel, kDXY_Voxel);
+                                     kYAxis, kNy_Voxel, kDY_Voxel);
 
   // 3rd, nested parameterization
-  auto voxel_dxyz_solid = new G4Box("vxyz", kDXY_Voxel/2.,
-                                            kDXY_Voxel/2., kDZ_Voxel/2.);
+  auto voxel_dxyz_solid = new G4Box("vxyz", kDX_Voxel/2.,
+                                            kDY_Voxel/2., kDZ_Voxel/2.);
   auto voxel_dxyz_lv = new G4LogicalVolume(voxel_dxyz_solid, water, "vxyz");
 
-  G4VNestedParameterisation* param { nullptr };
   auto wp_param = new PhantomPVP();
-  wp_param-> SetSegment(kNxy_Voxel, kDXY_Voxel);
+  wp_param-> SetSegment(kNx_Voxel, kDX_Voxel);
+  wp_param-> SetMaterialMap(phantom_-> BuildMaterials(),
+                            phantom_-> GetMaterialIndices(), kNy_Voxel);
   new G4PVParameterised("vxyz", voxel_dxyz_lv,
-                        voxel_dyz_lv, kXAxis, kNxy_Voxel, wp_param);
+                        voxel_dyz_lv, kXAxis, kNx_Voxel, wp_param);
 
   // vis attributes
-  auto va = new G4VisAttributes(G4Color(1.,1.,1.));
-  va-> SetVisibility(true);
-  world_lv-> SetVisAttributes(va);
-
-  va = new G4VisAttributes(G4Color(0.,0.8,0.8));
+  auto va = new G4VisAttributes(G4Color(0.,0.8,0.8));
   va-> SetVisibility(true);
   voxel_dz_lv-> SetVisAttributes(va);
 
   va = new G4VisAttributes();
   va-> SetVisibility(false);
-  phantom_lv-> SetVisAttributes(va);
   voxel_dyz_lv-> SetVisAttributes(va);
   voxel_dxyz_lv-> SetVisAttributes(va);
+}
 
-  return world_pv;
+// --------------------------------------------------------------------------
+void VoxelGeom::ConstructRegular(G4VPhysicalVolume* phantom_pv)
+{
+  const int kNx_Voxel = phantom_-> GetNx();
+  const int kNy_Voxel = phantom_-> GetNy();
+  const int kNz_Voxel = phantom_-> GetNz();
+  const double kDX_Voxel = phantom_-> GetDx();
+  const double kDY_Voxel = phantom_-> GetDy();
+  const double kDZ_Voxel = phantom_-> GetDz();
+
+  // G4PhantomParameterisation takes size_t indices, so that
+  // the mapped uint8 map is widened here, kept with the geometry
+  std::vector<G4Material*> materials = phantom_-> BuildMaterials();
+  const size_t kNvoxels = phantom_-> GetNvoxels();
+  auto indices = phantom_-> GetMaterialIndices();
+  material_indices_.assign(indices, indices + kNvoxels);
+
+  auto param = new G4PhantomParameterisation();
+  param-> SetVoxelDimensions(kDX_Voxel/2., kDY_Voxel/2., kDZ_Voxel/2.);
+  param-> SetNoVoxels(kNx_Voxel, kNy_Voxel, kNz_Voxel);
+  param-> SetMaterials(materials);
+  param-> SetMaterialIndices(material_indices_.data());
+  param-> BuildContainerSolid(phantom_pv);
+  param-> CheckVoxelsFillContainer(kNx_Voxel*kDX_Voxel/2.,
+                                   kNy_Voxel*kDY_Voxel/2.,
+                                   kNz_Voxel*kDZ_Voxel/2.);
+  // steps crossing voxels of the same material are merged, unless
+  // dose is scored per voxel (the whole deposit goes to the pre-step one)
+  param-> SetSkipEqualMaterials(dose_grid_ == nullptr);
+
+  auto voxel_solid = new G4Box("vxyz", kDX_Voxel/2.,
+                                       kDY_Voxel/2., kDZ_Voxel/2.);
+  auto voxel_lv = new G4LogicalVolume(voxel_solid, materials[0], "vxyz");
+
+  auto phantom_lv = phantom_pv-> GetLogicalVolume();
+  auto voxel_pv = new G4PVParameterised("vxyz", voxel_lv, phantom_lv,
+                                        kUndefined, kNvoxels, param);
+  voxel_pv-> SetRegularStructureId(1);
+
+  auto va = new G4VisAttributes();
+  va-> SetVisibility(false);
+  voxel_lv-> SetVisAttributes(va);
 }
 
 // --------------------------------------------------------------------------
 void VoxelGeom::ConstructSDandField()
 {
+  if ( dose_grid_ != nullptr ) {
+    auto dose_scorer = new DoseScorer();
+    dose_scorer-> SetSimData(simdata_);
+    dose_scorer-> SetDoseGrid(dose_grid_, phantom_-> GetNx(),
+                              phantom_-> GetNy(), phantom_-> GetNz(),
+                              layout_ == kRegular);
+    SetSensitiveDetector("vxyz", dose_scorer);
+    return;
+  }
+
   auto cal_scorer = new CalScorer();
   cal_scorer-> SetSimData(simdata_);
   SetSensitiveDetector("vxyz", cal_scorer);
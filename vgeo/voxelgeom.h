@@ -11,22 +11,50 @@ See the License for more information.
 #ifndef VOXEL_GEOM_H_
 #define VOXEL_GEOM_H_
 
+#include <cstddef>
+#include <memory>
+#include <vector>
 #include "G4VUserDetectorConstruction.hh"
 
+class CTPhantom;
+class DoseGrid;
+class G4LogicalVolume;
 class SimData;
 
 class VoxelGeom : public G4VUserDetectorConstruction {
 public:
   VoxelGeom() = default;
-  ~VoxelGeom() override = default;
+  ~VoxelGeom() override;
+
+  // phantom layout, nested replica/parameterisation or regular navigation
+  enum { kNested = 0, kRegular };
 
   void SetSimData(SimData* data);
 
+  // voxel dimensions and material map, homogeneous water if not set.
+  // the phantom is owned by the geometry (materials are looked up
+  // in tracking)
+  void SetPhantomData(CTPhantom* data);
+
+  void SetLayout(int layout);
+  int GetLayout() const;
+
+  // per-thread dose grids, scalar edep scoring if not set
+  void SetDoseGrid(DoseGrid* grid);
+
   G4VPhysicalVolume* Construct() override;
   void ConstructSDandField() override;
 
 private:
   SimData* simdata_;
+  std::unique_ptr<CTPhantom> phantom_;
+  // widened copy for G4PhantomParameterisation (not owned by it)
+  std::vector<std::size_t> material_indices_;
+  DoseGrid* dose_grid_ {nullptr};
+  int layout_ {kNested};
+
+  void ConstructNested(G4LogicalVolume* phantom_lv);
+  void ConstructRegular(G4VPhysicalVolume* phantom_pv);
 
 };
 
@@ -36,4 +64,24 @@ inline void VoxelGeom::SetSimData(SimData* data)
   simdata_ = data;
 }
 
+inline void VoxelGeom::SetPhantomData(CTPhantom* data)
+{
+  phantom_.reset(data);
+}
+
+inline void VoxelGeom::SetDoseGrid(DoseGrid* grid)
+{
+  dose_grid_ = grid;
+}
+
+inline void VoxelGeom::SetLayout(int layout)
+{
+  layout_ = layout;
+}
+
+inline int VoxelGeom::GetLayout() const
+{
+  return layout_;
+}
+
 #endif
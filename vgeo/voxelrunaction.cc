@@ -0,0 +1,301 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include "G4Threading.hh"
+#include "dosegrid.h"
+#include "dosesnapshot.h"
+#include "phsprecorder.h"
+#include "voxelrunaction.h"
+#include "util/benchreport.h"
+#include "util/timehistory.h"
+
+using namespace kut;
+
+// --------------------------------------------------------------------------
+namespace {
+
+// minimum voxels per reduction thread
+const int kMinChunk = 16384;
+
+} // end of namespace
+
+// ==========================================================================
+VoxelRunAction::VoxelRunAction()
+  : dose_grid_{nullptr}, ngrids_{0}, nx_{0}, ny_{0}, nz_{0},
+    dose_file_{""}, snapshot_{nullptr}, roi_threshold_{0.5},
+    recorder_{nullptr}, nrecorders_{0}, phsp_file_{""},
+    nhistories_{0}
+{
+}
+
+// --------------------------------------------------------------------------
+void VoxelRunAction::BeginOfRunAction(const G4Run* run)
+{
+  RunAction::BeginOfRunAction(run);
+
+  // grids are cleared before workers start, then the writer
+  if (IsMaster()) {
+    for ( int i = 0; i < nrecorders_; i++ ) {
+      if ( ! recorder_[i].Open(phsp_file_ + "." + std::to_string(i)) ) {
+        std::exit(EXIT_FAILURE);
+      }
+    }
+
+    for ( int i = 0; i < ngrids_; i++ ) {
+      dose_grid_[i].Reset();
+    }
+
+    if ( snapshot_ != nullptr ) {
+      snapshot_-> SetDoseGrid(dose_grid_, ngrids_, nx_, ny_, nz_);
+      snapshot_-> Start();
+    }
+  }
+}
+
+// --------------------------------------------------------------------------
+void VoxelRunAction::EndOfRunAction(const G4Run* run)
+{
+  // the grid of this thread is done, a pending snapshot need not wait
+  // for it. in sequential mode, the master owns the only grid
+  if ( dose_grid_ != nullptr &&
+       ( ! IsMaster() || ! G4Threading::IsMultithreadedApplication() ) ) {
+    auto tid = G4Threading::G4GetThreadId();
+    if ( tid == G4Threading::MASTER_ID ) tid = 0;
+    dose_grid_[tid].Finish();
+  }
+
+  RunAction::EndOfRunAction(run);
+}
+
+// --------------------------------------------------------------------------
+void VoxelRunAction::ReduceResult()
+{
+  RunAction::ReduceResult();
+
+  if ( dose_grid_ != nullptr ) ReduceDose();
+  if ( recorder_ != nullptr ) MergePhaseSpace();
+}
+
+// --------------------------------------------------------------------------
+void VoxelRunAction::ReduceDose()
+{
+  auto t0 = std::chrono::steady_clock::now();
+
+  const int nvoxels = nx_ * ny_ * nz_;
+
+  // dose already merged by snapshots, then what remains in the grids
+  if ( snapshot_ != nullptr ) {
+    snapshot_-> Stop();
+    dose_sum_ = snapshot_-> GetSum();
+    dose_sum2_ = snapshot_-> GetSum2();
+    nhistories_ = snapshot_-> GetNhistories();
+  } else {
+    dose_sum_.assign(nvoxels, 0.);
+    dose_sum2_.assign(nvoxels, 0.);
+    nhistories_ = 0;
+  }
+
+  std::size_t grid_memory = 0;
+  for ( int i = 0; i < ngrids_; i++ ) {
+    nhistories_ += dose_grid_[i].GetNhistories();
+    grid_memory += dose_grid_[i].GetMemorySize();
+  }
+
+  // voxel ranges are reduced in parallel, each range over all grids
+  int nthreads = std::thread::hardware_concurrency();
+  nthreads = std::min(std::max(nthreads, 1), ngrids_);
+  nthreads = std::max(std::min(nthreads, nvoxels / kMinChunk), 1);
+  int chunk = ( nvoxels + nthreads - 1 ) / nthreads;
+  chunk = ( chunk + 7 ) / 8 * 8;  // cache line of doubles
+
+  auto reduce = [this, nvoxels](int begin, int end) {
+    end = std::min(end, nvoxels);
+    for ( int i = 0; i < ngrids_; i++ ) {
+      const auto& grid = dose_grid_[i];
+      if ( grid.GetNvoxels() != nvoxels ) continue;  // idle thread
+      for ( int bank = 0; bank < 2; bank++ ) {
+        auto sum = grid.GetSum(bank);
+        auto sum2 = grid.GetSum2(bank);
+        for ( int j = begin; j < end; j++ ) {
+          dose_sum_[j] += sum[j];
+          dose_sum2_[j] += sum2[j];
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for ( int i = 1; i < nthreads; i++ ) {
+    threads.emplace_back(reduce, i * chunk, (i+1) * chunk);
+  }
+  reduce(0, chunk);
+  for ( auto& th : threads ) th.join();
+
+  auto t1 = std::chrono::steady_clock::now();
+  double reduce_ms =
+    std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+  // peak voxel and its statistical uncertainty
+  double total = 0.;
+  int imax = 0;
+  for ( int i = 0; i < nvoxels; i++ ) {
+    total += dose_sum_[i];
+    if ( dose_sum_[i] > dose_sum_[imax] ) imax = i;
+  }
+
+  double max_mean = 0., max_rel_error = 0.;
+  if ( nhistories_ > 1 && dose_sum_[imax] > 0. ) {
+    max_mean = dose_sum_[imax] / nhistories_;
+    max_rel_error = std::sqrt(GetRelativeVariance(imax));
+  }
+
+  auto report = BenchReport::GetBenchReport();
+  report-> SetLong("dose/voxels", nvoxels);
+  report-> SetLong("dose/histories", nhistories_);
+  report-> SetLong("dose/grid_memory_kb", grid_memory / 1024);
+  report-> SetLong("dose/reduce_threads", nthreads);
+  report-> SetDouble("dose/reduce_ms", reduce_ms);
+  report-> SetDouble("dose/edep_total", total);
+  report-> SetDouble("dose/edep_max", max_mean);
+  report-> SetDouble("dose/edep_max_rel_error", max_rel_error);
+  if ( snapshot_ != nullptr ) {
+    report-> SetLong("dose/snapshots", snapshot_-> GetNsnapshots());
+    report-> SetDouble("dose/snapshot_time", snapshot_-> GetWriteTime());
+  }
+
+  EvaluateFOM();
+
+  if ( dose_file_ != "" ) {
+    if ( WriteDose(dose_file_) ) {
+      std::cout << "[ MESSAGE ] dose distribution written to "
+                << dose_file_ << std::endl;
+    } else {
+      std::cout << "[ WARNING ] VoxelRunAction::ReduceResult() "
+                   "cannot write a dose file, " << dose_file_ << std::endl;
+    }
+  }
+}
+
+// --------------------------------------------------------------------------
+void VoxelRunAction::MergePhaseSpace()
+{
+  // event loops are over, remaining records are flushed from here
+  uint64_t nrecords = 0;
+  double write_time = 0., stall_time = 0.;
+  std::vector<std::string> parts;
+  for ( int i = 0; i < nrecorders_; i++ ) {
+    recorder_[i].Close();
+    nrecords += recorder_[i].GetNrecords();
+    write_time += recorder_[i].GetWriteTime();
+    stall_time += recorder_[i].GetStallTime();
+    parts.push_back(recorder_[i].GetFileName());
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  if ( ! PhspRecorder::Merge(phsp_file_, parts, nrecords) ) {
+    std::cout << "[ WARNING ] VoxelRunAction::MergePhaseSpace() "
+                 "cannot merge a phase-space file, " << phsp_file_
+              << std::endl;
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double merge_time = std::chrono::duration<double>(t1 - t0).count();
+
+  double size_mb = nrecords * sizeof(phspformat::PhspRecord) / 1.e6;
+
+  auto report = BenchReport::GetBenchReport();
+  report-> SetString("phsp/file", phsp_file_);
+  report-> SetLong("phsp/records", nrecords);
+  report-> SetDouble("phsp/size_mb", size_mb);
+  report-> SetDouble("phsp/write_time", write_time);
+  report-> SetDouble("phsp/stall_time", stall_time);
+  report-> SetDouble("phsp/write_mbps",
+                     write_time > 0. ? size_mb / write_time : 0.);
+  report-> SetDouble("phsp/merge_time", merge_time);
+  report-> SetDouble("phsp/merge_mbps",
+                     merge_time > 0. ? size_mb / merge_time : 0.);
+
+  std::cout << "[ MESSAGE ] phase-space written to " << phsp_file_
+            << " (" << nrecords << " particles)" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+double VoxelRunAction::GetRelativeVariance(int index) const
+{
+  // variance of the mean relative to the mean squared, history by history
+  double n = nhistories_;
+  if ( n < 2. || dose_sum_[index] <= 0. ) return 0.;
+
+  double mean = dose_sum_[index] / n;
+  double var = ( dose_sum2_[index] / n - mean * mean ) / (n - 1.);
+  return std::max(var, 0.) / ( mean * mean );
+}
+
+// --------------------------------------------------------------------------
+void VoxelRunAction::EvaluateFOM() const
+{
+  if ( nhistories_ < 2 ) return;
+
+  // voxels in the region of interest
+  std::vector<int> voxels;
+  if ( roi_min_.size() == 3 && roi_max_.size() == 3 ) {
+    int imin[3], imax[3];
+    int ndim[3] = { nx_, ny_, nz_ };
+    for ( int k = 0; k < 3; k++ ) {
+      imin[k] = std::max(roi_min_[k], 0);
+      imax[k] = std::min(roi_max_[k], ndim[k] - 1);
+    }
+    for ( int iz = imin[2]; iz <= imax[2]; iz++ ) {
+      for ( int iy = imin[1]; iy <= imax[1]; iy++ ) {
+        for ( int ix = imin[0]; ix <= imax[0]; ix++ ) {
+          int index = ix + nx_ * ( iy + ny_ * iz );
+          if ( dose_sum_[index] > 0. ) voxels.push_back(index);
+        }
+      }
+    }
+  } else {
+    auto dmax = *std::max_element(dose_sum_.begin(), dose_sum_.end());
+    for ( std::size_t i = 0; i < dose_sum_.size(); i++ ) {
+      if ( dose_sum_[i] > 0. && dose_sum_[i] >= roi_threshold_ * dmax ) {
+        voxels.push_back(i);
+      }
+    }
+  }
+  if ( voxels.empty() ) return;
+
+  double rel_var = 0.;
+  for ( auto index : voxels ) rel_var += GetRelativeVariance(index);
+  rel_var /= voxels.size();
+
+  // event processing time, as for EPS
+  auto gtimer = TimeHistory::GetTimeHistory();
+  double proc_time = gtimer-> GetTime("RunEnd") -
+                     gtimer-> GetTime("FirstEventStart");
+  if ( rel_var <= 0. || proc_time <= 0. ) return;
+
+  double fom = 1. / ( rel_var * proc_time );
+
+  auto report = BenchReport::GetBenchReport();
+  report-> SetLong("dose/roi_voxels", voxels.size());
+  report-> SetDouble("dose/roi_rel_error", std::sqrt(rel_var));
+  report-> SetDouble("dose/fom", fom);
+  report-> SetDouble("dose/fom_cpu", fom / std::max(ngrids_, 1));
+}
+
+// --------------------------------------------------------------------------
+bool VoxelRunAction::WriteDose(const std::string& fname) const
+{
+  return DoseSnapshot::WriteDoseFile(fname, nx_, ny_, nz_, nhistories_,
+                                     dose_sum_.data(), dose_sum2_.data());
+}
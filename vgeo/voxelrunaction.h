@@ -0,0 +1,116 @@
+/*============================================================================
+Copyright 2022 Koichi Murakami
+
+Distributed under the OSI-approved BSD License (the "License");
+see accompanying file LICENSE for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the License for more information.
+============================================================================*/
+#ifndef VOXEL_RUN_ACTION_H_
+#define VOXEL_RUN_ACTION_H_
+
+#include <string>
+#include <vector>
+#include "common/runaction.h"
+
+class DoseGrid;
+class DoseSnapshot;
+class PhspRecorder;
+
+// run action reducing per-thread dose grids and merging phase-space
+// recorders at the end of run
+class VoxelRunAction : public RunAction {
+public:
+  VoxelRunAction();
+  ~VoxelRunAction() override = default;
+
+  void SetDoseGrid(DoseGrid* grid, int ngrids, int nx, int ny, int nz);
+  void SetDoseFile(const std::string& fname);
+
+  // periodic snapshots during a run (master only)
+  void SetDoseSnapshot(DoseSnapshot* snapshot);
+
+  // region for the figure of merit, voxel index ranges (inclusive).
+  // without ROI, voxels above the threshold (fraction of max) are used
+  void SetROI(const std::vector<int>& imin, const std::vector<int>& imax);
+  void SetROIThreshold(double val);
+
+  // per-thread recorders, merged into a phase-space file
+  void SetPhspRecorder(PhspRecorder* recorder, int nrecorders,
+                       const std::string& fname);
+
+  void BeginOfRunAction(const G4Run* run) override;
+  void EndOfRunAction(const G4Run* run) override;
+
+  void ReduceResult() override;
+
+  bool WriteDose(const std::string& fname) const;
+
+private:
+  DoseGrid* dose_grid_;
+  int ngrids_;
+  int nx_, ny_, nz_;
+  std::string dose_file_;
+  DoseSnapshot* snapshot_;
+  std::vector<int> roi_min_, roi_max_;
+  double roi_threshold_;
+  PhspRecorder* recorder_;
+  int nrecorders_;
+  std::string phsp_file_;
+
+  long nhistories_;
+  std::vector<double> dose_sum_;
+  std::vector<double> dose_sum2_;
+
+  void ReduceDose();
+  void MergePhaseSpace();
+  double GetRelativeVariance(int index) const;
+  void EvaluateFOM() const;
+
+};
+
+// ==========================================================================
+inline void VoxelRunAction::SetDoseGrid(DoseGrid* grid, int ngrids,
+                                        int nx, int ny, int nz)
+{
+  dose_grid_ = grid;
+  ngrids_ = ngrids;
+  nx_ = nx;
+  ny_ = ny;
+  nz_ = nz;
+}
+
+inline void VoxelRunAction::SetDoseFile(const std::string& fname)
+{
+  dose_file_ = fname;
+}
+
+inline void VoxelRunAction::SetDoseSnapshot(DoseSnapshot* snapshot)
+{
+  snapshot_ = snapshot;
+}
+
+inline void VoxelRunAction::SetROI(const std::vector<int>& imin,
+                                   const std::vector<int>& imax)
+{
+  roi_min_ = imin;
+  roi_max_ = imax;
+}
+
+inline void VoxelRunAction::SetROIThreshold(double val)
+{
+  roi_threshold_ = val;
+}
+
+inline void VoxelRunAction::SetPhspRecorder(PhspRecorder* recorder,
+                                            int nrecorders,
+                                            const std::string& fname)
+{
+  recorder_ = recorder;
+  nrecorders_ = nrecorders;
+  phsp_file_ = fname;
+}
+
+#endif